@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include <type_traits>
+
+namespace bench {
+
+// Walks argv for the "-x value" options the benchmarks take:
+//   for (bench::args args(argc, argv); !args.done();) {
+//       if (auto v = args.value("-n"))
+//           messages = std::strtoul(v, nullptr, 10);
+//       else
+//           return usage();
+//   }
+class args {
+public:
+    args(int argc, char** argv)
+        : argc_(argc)
+        , argv_(argv) {}
+
+    [[nodiscard]] bool done() const noexcept { return i_ >= argc_; }
+
+    // The value following `flag` if the current argument is `flag`, consuming both; otherwise
+    // null, leaving the position unchanged.
+    [[nodiscard]] const char* value(const char* flag) noexcept {
+        if (i_ + 1 >= argc_ || std::strcmp(argv_[i_], flag) != 0)
+            return nullptr;
+        i_ += 2;
+        return argv_[i_ - 1];
+    }
+
+private:
+    int    argc_;
+    char** argv_;
+    int    i_{1};
+};
+
+// Comma-separated list as a set of strings, unsigned integers or doubles, e.g. "16,256".
+template <typename T>
+std::set<T> split(const char* arg) {
+    std::set<T> out;
+    std::string s(arg);
+    for (std::size_t pos{0}; pos <= s.size();) {
+        auto comma = std::min(s.find(',', pos), s.size());
+        auto item  = s.substr(pos, comma - pos);
+        if constexpr (std::is_same_v<T, std::string>)
+            out.insert(item);
+        else if constexpr (std::is_floating_point_v<T>)
+            out.insert(std::strtod(item.c_str(), nullptr));
+        else
+            out.insert(static_cast<T>(std::strtoul(item.c_str(), nullptr, 10)));
+        pos = comma + 1;
+    }
+    return out;
+}
+
+// Output CSV that is closed when it goes out of scope. Stays closed, and get() null, unless
+// open() is given a path.
+class csv_file {
+public:
+    csv_file() = default;
+
+    csv_file(const csv_file&)            = delete;
+    csv_file& operator=(const csv_file&) = delete;
+
+    ~csv_file() {
+        if (file_ != nullptr)
+            std::fclose(file_);
+    }
+
+    // Creates `path` and writes the header line. An empty path is not an error and leaves the
+    // file closed; a path that cannot be created is reported on stderr and returns false.
+    [[nodiscard]] bool open(std::string const& path, const char* header) {
+        if (path.empty())
+            return true;
+        file_ = std::fopen(path.c_str(), "w");
+        if (file_ == nullptr) {
+            std::perror(path.c_str());
+            return false;
+        }
+        std::fprintf(file_, "%s\n", header);
+        return true;
+    }
+
+    [[nodiscard]] std::FILE* get() const noexcept { return file_; }
+
+private:
+    std::FILE* file_{nullptr};
+};
+
+}  // namespace bench
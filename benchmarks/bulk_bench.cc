@@ -0,0 +1,106 @@
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <nanobench.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "affinity.h"
+#include "placement.h"
+#include "spsc_queue.h"
+
+constexpr std::size_t TOTAL_BYTES = 64 << 20;
+constexpr std::size_t CAPACITY    = 1 << 10;
+constexpr std::size_t BATCH       = 32;
+
+template <std::size_t Bytes>
+struct Record {
+    uint64_t seq;
+    char     payload[Bytes - sizeof(uint64_t)];
+};
+
+template <typename Produce, typename Consume>
+void run_pair(Produce&& produce, Consume&& consume) {
+    std::atomic<bool> ready{false};
+    std::thread       consumer = std::thread([&] {
+        nsqueue::pin_thread(bench::cpus().consumer);
+        while (!ready.load(std::memory_order_acquire))
+            continue;
+        consume();
+    });
+
+    nsqueue::pin_thread(bench::cpus().producer);
+
+    ready.store(true, std::memory_order_release);
+
+    produce();
+    consumer.join();
+}
+
+template <std::size_t Bytes>
+void bench_record_size(ankerl::nanobench::Bench& bench) {
+    using record_t            = Record<Bytes>;
+    constexpr std::size_t n   = TOTAL_BYTES / Bytes;
+    auto                  q   = std::make_unique<nsqueue::spsc_queue<record_t, CAPACITY>>();
+    std::vector<record_t> src(BATCH);
+
+    bench.title(std::to_string(Bytes) + "B records").unit("byte").batch(TOTAL_BYTES);
+
+    bench.run("emplace/pop", [&] {
+        run_pair(
+            [&] {
+                for (uint64_t i{}; i < n; ++i) {
+                    src[0].seq = i;
+                    q->force_push(src[0]);
+                }
+            },
+            [&] {
+                record_t r;
+                for (uint64_t i{}; i < n; ++i) {
+                    q->force_pop(r);
+                    if (r.seq != i)
+                        throw std::runtime_error("wrong ordering");
+                }
+            });
+    });
+
+    for (auto hint : {nsqueue::store_hint::cached, nsqueue::store_hint::streaming}) {
+        const char* name = hint == nsqueue::store_hint::cached ? "bulk" : "bulk streaming";
+        bench.run(name, [&] {
+            run_pair(
+                [&] {
+                    for (uint64_t i{}; i < n;) {
+                        const auto want = std::min<uint64_t>(BATCH, n - i);
+                        for (uint64_t k{}; k < want; ++k)
+                            src[k].seq = i + k;
+                        i += q->push_bulk(src.data(), want, hint);
+                    }
+                },
+                [&] {
+                    std::vector<record_t> dst(BATCH);
+                    for (uint64_t i{}; i < n;) {
+                        const auto got = q->pop_bulk(dst.data(), BATCH);
+                        for (uint64_t k{}; k < got; ++k) {
+                            if (dst[k].seq != i + k)
+                                throw std::runtime_error("wrong ordering");
+                        }
+                        i += got;
+                    }
+                });
+        });
+    }
+}
+
+int main() {
+    ankerl::nanobench::Bench bench;
+    bench.warmup(2).epochs(20).minEpochIterations(1).performanceCounters(true);
+
+    bench_record_size<64>(bench);
+    bench_record_size<256>(bench);
+    bench_record_size<1024>(bench);
+    bench_record_size<4096>(bench);
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <nanobench.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "journal.h"
+
+struct Record {
+    uint64_t seq{};
+    char     payload[56]{};
+};
+
+using journal_t = nsqueue::journal<Record, (1 << 16)>;
+
+constexpr std::size_t WARMUP = 1;
+constexpr std::size_t EPOCHS = 10;
+
+// Times `n` appends and the final sync() only. Every run gets its own journal in a fresh
+// directory, created before the measurement starts and removed once it is over, so directory
+// cleanup and meta file creation stay out of the numbers.
+void bench_append(ankerl::nanobench::Bench& bench, const char* name,
+                  const std::filesystem::path& dir, nsqueue::journal_options opts, std::size_t n) {
+    std::vector<std::unique_ptr<journal_t>> journals;
+    for (std::size_t run{0}; run < WARMUP + EPOCHS; ++run) {
+        std::filesystem::remove_all(dir / std::to_string(run));
+        journals.push_back(std::make_unique<journal_t>(dir / std::to_string(run), opts));
+    }
+
+    std::size_t next{0};
+    bench.batch(n).run(name, [&] {
+        auto&  j = *journals.at(next++);
+        Record r{};
+        for (uint64_t i{}; i < n; ++i) {
+            r.seq = i;
+            j.append(r);
+        }
+        j.sync();
+    });
+
+    journals.clear();
+    std::filesystem::remove_all(dir);
+}
+
+int main(int argc, char** argv) {
+    // Pass a directory on the filesystem under test; defaults to the system temp directory.
+    std::filesystem::path dir = argc > 1 ? std::filesystem::path(argv[1])
+                                         : std::filesystem::temp_directory_path();
+    dir /= "nsqueue_journal_bench_" + std::to_string(::getpid());
+
+    ankerl::nanobench::Bench bench;
+    bench.warmup(WARMUP).epochs(EPOCHS).epochIterations(1).performanceCounters(true);
+    bench.title("journal append (64B records)").unit("append");
+
+    constexpr std::size_t LARGE = 1'000'000;
+    constexpr std::size_t SMALL = 2'000;
+
+    bench_append(bench, "none", dir, {nsqueue::durability::none}, LARGE);
+    bench_append(bench, "batched/4096", dir, {nsqueue::durability::batched, 4096}, LARGE);
+    bench_append(bench, "batched/256", dir, {nsqueue::durability::batched, 256}, LARGE);
+    bench_append(bench, "every_append", dir, {nsqueue::durability::every_append}, SMALL);
+    return 0;
+}
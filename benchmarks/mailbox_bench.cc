@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "affinity.h"
+#include "placement.h"
+#include "small_spsc_queue.h"
+#include "spsc_queue.h"
+
+// Actor-style fan-out: one producer posts round-robin into many small mailboxes and one consumer
+// sweeps them. Reports the memory each mailbox costs and the aggregate message rate. For the
+// shared_line layout pass two SMT siblings as "mailbox_bench <producer cpu> <consumer cpu>".
+constexpr std::size_t MAILBOXES = 10'000;
+constexpr std::size_t CAPACITY  = 32;
+constexpr std::size_t ROUNDS    = 200;
+constexpr int         REPEATS   = 5;
+
+// Counts heap bytes so the footprint includes storage a queue allocates out of line.
+std::atomic<std::size_t> heap_bytes{0};
+
+void* operator new(std::size_t n) {
+    heap_bytes.fetch_add(n, std::memory_order_relaxed);
+    if (void* p = std::malloc(n))
+        return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t n, std::align_val_t al) {
+    heap_bytes.fetch_add(n, std::memory_order_relaxed);
+    auto a = static_cast<std::size_t>(al);
+    if (void* p = std::aligned_alloc(a, (n + a - 1) / a * a))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+struct Message {
+    uint32_t actor;
+    uint32_t seq;
+};
+
+template <typename Q>
+double run_once(Q* boxes, int producer_cpu, int consumer_cpu) {
+    std::atomic<bool> ready{false};
+    std::thread       consumer = std::thread([&] {
+        nsqueue::pin_thread(consumer_cpu);
+        std::vector<uint32_t> expected(MAILBOXES, 0);
+        while (!ready.load(std::memory_order_acquire))
+            continue;
+        std::size_t received{0};
+        while (received < MAILBOXES * ROUNDS) {
+            for (std::size_t a{0}; a < MAILBOXES; ++a) {
+                Message m;
+                while (boxes[a].pop(m)) {
+                    if (m.actor != a || m.seq != expected[a]++)
+                        throw std::runtime_error("wrong ordering");
+                    ++received;
+                }
+            }
+        }
+    });
+
+    nsqueue::pin_thread(producer_cpu);
+    ready.store(true, std::memory_order_release);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t r{0}; r < ROUNDS; ++r) {
+        for (uint32_t a{0}; a < MAILBOXES; ++a) {
+            while (!boxes[a].push(Message{a, r}))
+                continue;
+        }
+    }
+    consumer.join();
+    auto t1 = std::chrono::steady_clock::now();
+
+    return static_cast<double>(MAILBOXES * ROUNDS) / std::chrono::duration<double>(t1 - t0).count();
+}
+
+template <typename Q>
+void report(const char* name, int producer_cpu, int consumer_cpu) {
+    const auto before = heap_bytes.load();
+    auto       boxes  = std::make_unique<Q[]>(MAILBOXES);
+    const auto bytes  = heap_bytes.load() - before;
+
+    double best{0};
+    for (int i{0}; i < REPEATS; ++i)
+        best = std::max(best, run_once(boxes.get(), producer_cpu, consumer_cpu));
+
+    std::printf("| %-26s | %10zu | %10.1f | %10.2f |\n",
+                name,
+                bytes / MAILBOXES,
+                static_cast<double>(bytes) / (1 << 20),
+                best / 1e6);
+}
+
+int main(int argc, char** argv) {
+    const int producer_cpu = argc > 2 ? std::atoi(argv[1]) : bench::cpus().producer;
+    const int consumer_cpu = argc > 2 ? std::atoi(argv[2]) : bench::cpus().consumer;
+
+    std::printf("%zu mailboxes x %zu slots, %zu-byte messages\n",
+                MAILBOXES, CAPACITY, sizeof(Message));
+    std::printf("| %-26s | %10s | %10s | %10s |\n", "queue", "bytes/box", "total MiB", "Mmsg/s");
+
+    report<nsqueue::spsc_queue<Message, CAPACITY>>("spsc_queue", producer_cpu, consumer_cpu);
+    report<nsqueue::small_spsc_queue<Message, CAPACITY>>(
+        "small_spsc_queue split", producer_cpu, consumer_cpu);
+    report<nsqueue::small_spsc_queue<Message, CAPACITY, nsqueue::queue_layout::shared_line>>(
+        "small_spsc_queue shared", producer_cpu, consumer_cpu);
+
+    return 0;
+}
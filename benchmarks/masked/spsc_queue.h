@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "detail/cache_utils.h"
+
+// nsqueue::spsc_queue as it was before the switch to free-running cursors: indices are masked
+// on every advance, one slot stays empty to tell full from empty, and size() branches on
+// wrap-around. Kept only so the benchmarks can compare the two hot paths.
+namespace masked {
+
+template <typename T, std::size_t N>
+class spsc_queue {
+    static_assert((N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+    using index_t = std::size_t;
+
+    spsc_queue()
+        : items_(std::make_unique<AlignedData[]>(N)) {}
+    spsc_queue(const spsc_queue& other)            = delete;
+    spsc_queue& operator=(const spsc_queue& other) = delete;
+
+    template <typename... Args>
+    [[nodiscard]] bool emplace(Args&&... args) noexcept {
+        auto writeIdx     = writer_.writeIndex_.load(std::memory_order_relaxed);
+        auto nextWriteIdx = (writeIdx + 1) & mask_;
+
+        if (nextWriteIdx == writer_.readIndexCache_) [[unlikely]] {
+            writer_.readIndexCache_ = reader_.readIndex_.load(std::memory_order_acquire);
+            if (nextWriteIdx == writer_.readIndexCache_) [[unlikely]]
+                return false;
+        }
+
+        new (&items_[writeIdx].mObj) T(std::forward<Args>(args)...);
+        writer_.writeIndex_.store(nextWriteIdx, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    template <typename... Args>
+    void force_emplace(Args&&... args) noexcept {
+        auto writeIdx     = writer_.writeIndex_.load(std::memory_order_relaxed);
+        auto nextWriteIdx = (writeIdx + 1) & mask_;
+
+        while (nextWriteIdx == writer_.readIndexCache_) {
+            writer_.readIndexCache_ = reader_.readIndex_.load(std::memory_order_acquire);
+        }
+
+        new (&items_[writeIdx].mObj) T(std::forward<Args>(args)...);
+        writer_.writeIndex_.store(nextWriteIdx, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool push(T const& item) noexcept { return emplace(item); }
+
+    void force_push(T const& item) noexcept { return force_emplace(item); }
+
+    void force_pop(T& item) noexcept {
+        auto readIdx  = reader_.readIndex_.load(std::memory_order_relaxed);
+        auto writeIdx = reader_.writeIndexCache_;
+        while (readIdx == writeIdx) {
+            writeIdx = reader_.writeIndexCache_
+                = writer_.writeIndex_.load(std::memory_order_acquire);
+        }
+
+        item = std::move(items_[readIdx].mObj);
+
+        auto nextReadIdx = (readIdx + 1) & mask_;
+        reader_.readIndex_.store(nextReadIdx, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool pop(T& item) noexcept {
+        auto readIdx  = reader_.readIndex_.load(std::memory_order_relaxed);
+        auto writeIdx = reader_.writeIndexCache_;
+        if (readIdx == writeIdx) [[unlikely]] {
+            writeIdx = reader_.writeIndexCache_
+                = writer_.writeIndex_.load(std::memory_order_acquire);
+            if (readIdx == writeIdx) [[unlikely]]
+                return false;
+        }
+
+        item = std::move(items_[readIdx].mObj);
+
+        auto nextReadIdx = (readIdx + 1) & mask_;
+        reader_.readIndex_.store(nextReadIdx, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    [[nodiscard]] index_t size() const noexcept {
+        auto w = writer_.writeIndex_.load(std::memory_order_acquire);
+        auto r = reader_.readIndex_.load(std::memory_order_acquire);
+        return (w >= r) ? w - r : (N - r) + w;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return writer_.writeIndex_.load(std::memory_order_acquire)
+            == reader_.readIndex_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] index_t capacity() const noexcept { return mask_; }
+
+private:
+    struct AlignedData {
+        alignas(nsqueue::details::cacheLineSize * 2) T mObj{};
+    };
+    static constexpr index_t mask_{N - 1};
+
+    std::unique_ptr<AlignedData[]> items_;
+
+    struct alignas(nsqueue::details::cacheLineSize) ReadState {
+        std::atomic<index_t> readIndex_{0};
+        index_t              writeIndexCache_{0};
+    } reader_;
+    struct alignas(nsqueue::details::cacheLineSize) WriteState {
+        std::atomic<index_t> writeIndex_{0};
+        index_t              readIndexCache_{0};
+    } writer_;
+};
+
+}  // namespace masked
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class mutex_thread_pool {
+public:
+    explicit mutex_thread_pool(std::size_t threads) {
+        for (std::size_t i{0}; i < threads; ++i) {
+            workers_.emplace_back([this] {
+                for (;;) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(m_);
+                        cv_.wait(lock, [&] { return stop_ || !q_.empty(); });
+                        if (q_.empty())
+                            return;
+                        task = std::move(q_.front());
+                        q_.pop();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+    ~mutex_thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& w : workers_)
+            w.join();
+    }
+    template <typename F>
+    void submit(F&& func) {
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            q_.emplace(std::forward<F>(func));
+        }
+        cv_.notify_one();
+    }
+
+private:
+    std::vector<std::thread>          workers_;
+    std::queue<std::function<void()>> q_;
+    std::mutex                        m_;
+    std::condition_variable           cv_;
+    bool                              stop_{false};
+};
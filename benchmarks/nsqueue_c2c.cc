@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "affinity.h"
+#include "args.h"
+#include "detail/tsc.h"
+#include "spsc_queue.h"
+#include "topology.h"
+
+// Core-to-core handoff latency over spsc_queue. For every pair of cpus one thread pushes a token
+// through a queue and the other pushes it back through a second queue, both with the queue's
+// force_push/force_pop hot path; round trips are timed with rdtscp on the initiating side.
+//   nsqueue_c2c [-c cpu-list] [-m max-cpus] [-n round-trips] [-o file.csv]
+// -c restricts the cpus (default: all this process may use), -m samples that many of them
+// evenly. Prints the median one-way latency (half the round trip) as a matrix, then writes
+// median and p99 round trips for every measured pair as CSV to stdout or the -o file.
+// Round trips are symmetric, so each unordered pair is measured once.
+
+constexpr std::size_t CAPACITY = 64;
+constexpr std::size_t WARMUP   = 1'000;
+
+using queue = nsqueue::spsc_queue<std::uint64_t, CAPACITY>;
+
+struct pair_result {
+    double median_ns;
+    double p99_ns;
+};
+
+// Throws std::runtime_error if either thread could not be pinned, e.g. to a cpu outside the
+// affinity mask or offline. Both sides still run the exchange so that neither is left waiting.
+pair_result measure(int initiator, int responder, std::size_t rounds) {
+    auto ping = std::make_unique<queue>();
+    auto pong = std::make_unique<queue>();
+
+    bool echoPinned{false};
+    std::thread echo([&] {
+        echoPinned = nsqueue::pin_thread(responder);
+        std::uint64_t v;
+        for (std::size_t i{0}; i < WARMUP + rounds; ++i) {
+            ping->force_pop(v);
+            pong->force_push(v);
+        }
+    });
+    const bool pinned = nsqueue::pin_thread(initiator);
+
+    std::vector<std::uint64_t> ticks(rounds);
+    std::uint64_t              v;
+    for (std::size_t i{0}; i < WARMUP + rounds; ++i) {
+        auto t0 = nsqueue::details::tscp_now();
+        ping->force_push(i);
+        pong->force_pop(v);
+        auto t1 = nsqueue::details::tscp_now();
+        if (i >= WARMUP)
+            ticks[i - WARMUP] = t1 - t0;
+    }
+    echo.join();
+    if (!pinned || !echoPinned)
+        throw std::runtime_error("cannot run on cpu " +
+                                 std::to_string(pinned ? responder : initiator));
+
+    std::sort(ticks.begin(), ticks.end());
+    const double ns = nsqueue::details::tsc_ns_per_tick();
+    return {static_cast<double>(ticks[ticks.size() / 2]) * ns,
+            static_cast<double>(ticks[std::min(ticks.size() - 1, ticks.size() * 99 / 100)]) * ns};
+}
+
+// 256-colour background from green (fast) to red (slow).
+const char* shade(double v, double lo, double hi) {
+    static const char* ramp[] = {"\x1b[48;5;22m", "\x1b[48;5;28m", "\x1b[48;5;100m",
+                                 "\x1b[48;5;136m", "\x1b[48;5;166m", "\x1b[48;5;160m"};
+    if (hi <= lo)
+        return ramp[0];
+    auto i = static_cast<std::size_t>((v - lo) / (hi - lo) * 5.999);
+    return ramp[std::min<std::size_t>(i, 5)];
+}
+
+void usage() {
+    std::fprintf(stderr,
+                 "usage: nsqueue_c2c [-c cpu-list] [-m max-cpus] [-n round-trips] [-o file.csv]\n");
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> cpus = nsqueue::allowed_cpus();
+    std::size_t      maxCpus{0};
+    std::size_t      rounds{20'000};
+    std::string      csvPath;
+    try {
+        for (bench::args args(argc, argv); !args.done();) {
+            if (auto v = args.value("-c"))
+                cpus = nsqueue::parse_cpu_list(v);
+            else if (auto v = args.value("-m"))
+                maxCpus = std::strtoul(v, nullptr, 10);
+            else if (auto v = args.value("-n"))
+                rounds = std::strtoul(v, nullptr, 10);
+            else if (auto v = args.value("-o"))
+                csvPath = v;
+            else {
+                usage();
+                return 1;
+            }
+        }
+    } catch (std::exception const& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    if (rounds == 0 || cpus.size() < 2) {
+        std::fprintf(stderr, "need at least two cpus and one round trip\n");
+        return 1;
+    }
+    if (maxCpus >= 2 && cpus.size() > maxCpus) {
+        std::vector<int> sampled;
+        for (std::size_t i{0}; i < maxCpus; ++i)
+            sampled.push_back(cpus[i * (cpus.size() - 1) / (maxCpus - 1)]);
+        cpus = sampled;
+    }
+
+    // Opened before measuring so that a bad path does not throw away the results.
+    constexpr const char* header = "cpu_a,cpu_b,rtt_median_ns,rtt_p99_ns";
+    bench::csv_file       file;
+    if (!file.open(csvPath, header))
+        return 1;
+
+    const std::size_t   n = cpus.size();
+    std::vector<double> median(n * n, 0.0), p99(n * n, 0.0);
+    try {
+        for (std::size_t a{0}; a < n; ++a) {
+            for (std::size_t b{a + 1}; b < n; ++b) {
+                auto r            = measure(cpus[a], cpus[b], rounds);
+                median[a * n + b] = median[b * n + a] = r.median_ns;
+                p99[a * n + b]    = p99[b * n + a]    = r.p99_ns;
+            }
+            std::fprintf(stderr, "\rmeasured %zu/%zu cpus", a + 1, n);
+        }
+        std::fprintf(stderr, "\n");
+    } catch (std::exception const& e) {
+        std::fprintf(stderr, "\n%s\n", e.what());
+        return 1;
+    }
+
+    double lo{1e300}, hi{0};
+    for (std::size_t i{0}; i < n * n; ++i) {
+        if (i / n == i % n)
+            continue;
+        lo = std::min(lo, median[i] / 2);
+        hi = std::max(hi, median[i] / 2);
+    }
+
+    const bool color = ::isatty(STDOUT_FILENO) != 0;
+    std::printf("one-way latency, median ns (round trip / 2)\n%5s", "");
+    for (int c : cpus)
+        std::printf(" %6d", c);
+    std::printf("\n");
+    for (std::size_t a{0}; a < n; ++a) {
+        std::printf("%5d", cpus[a]);
+        for (std::size_t b{0}; b < n; ++b) {
+            if (a == b) {
+                std::printf(" %6s", "-");
+                continue;
+            }
+            double v = median[a * n + b] / 2;
+            if (color)
+                std::printf(" %s%6.0f\x1b[0m", shade(v, lo, hi), v);
+            else
+                std::printf(" %6.0f", v);
+        }
+        std::printf("\n");
+    }
+
+    std::FILE* csv = file.get();
+    if (csv == nullptr) {
+        std::printf("\n%s\n", header);
+        csv = stdout;
+    }
+    for (std::size_t a{0}; a < n; ++a)
+        for (std::size_t b{a + 1}; b < n; ++b)
+            std::fprintf(csv, "%d,%d,%.1f,%.1f\n", cpus[a], cpus[b], median[a * n + b],
+                         p99[a * n + b]);
+    return 0;
+}
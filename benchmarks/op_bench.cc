@@ -0,0 +1,93 @@
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <nanobench.h>
+#include <string>
+
+#include "args.h"
+#include "spsc_queue.h"
+
+// Cost of single queue operations on one thread, for catching codegen regressions in the hot
+// path. The queue is kept half full so every call sees the steady state. A push cannot be timed
+// without a matching pop on the same thread, so push-side costs are paired with pop(), which only
+// discards, and the difference between "emplace + pop()" and "emplace + pop(T&)" is the copy out.
+// size() and empty() and the full/empty rejections are timed on their own.
+//   op_bench [-o results.json]
+// Writes nanobench's JSON (cycles, instructions and branch misses per op where the kernel allows
+// perf counters) to the given file, op_bench.json by default, for diffing across commits.
+
+constexpr std::size_t CAPACITY = 1 << 10;
+
+template <std::size_t Bytes>
+struct Payload {
+    std::array<std::uint64_t, Bytes / sizeof(std::uint64_t)> words;
+};
+
+template <std::size_t Bytes>
+void bench_payload(ankerl::nanobench::Bench& bench) {
+    using payload = Payload<Bytes>;
+    using queue   = nsqueue::spsc_queue<payload, CAPACITY>;
+
+    auto    q = std::make_unique<queue>();
+    payload in{}, out{};
+    for (std::size_t i{0}; i < CAPACITY / 2; ++i)
+        q->force_push(in);
+
+    bench.title(std::to_string(Bytes) + "B").unit("op");
+    bench.run("emplace + pop()", [&] {
+        ++in.words[0];
+        ankerl::nanobench::doNotOptimizeAway(q->emplace(in));
+        ankerl::nanobench::doNotOptimizeAway(q->pop());
+    });
+    bench.run("emplace + pop(T&)", [&] {
+        ++in.words[0];
+        ankerl::nanobench::doNotOptimizeAway(q->emplace(in));
+        ankerl::nanobench::doNotOptimizeAway(q->pop(out));
+    });
+    bench.run("emplace + consume_one", [&] {
+        ++in.words[0];
+        ankerl::nanobench::doNotOptimizeAway(q->emplace(in));
+        q->consume_one([&](payload const& p) { out.words[0] += p.words[0]; });
+    });
+    bench.run("size", [&] { ankerl::nanobench::doNotOptimizeAway(q->size()); });
+    bench.run("empty", [&] { ankerl::nanobench::doNotOptimizeAway(q->empty()); });
+    ankerl::nanobench::doNotOptimizeAway(out);
+
+    // Rejections: emplace on a full queue, pop on an empty one.
+    while (q->push(in))
+        continue;
+    bench.run("emplace (full)", [&] { ankerl::nanobench::doNotOptimizeAway(q->emplace(in)); });
+    while (q->pop())
+        continue;
+    bench.run("pop (empty)", [&] { ankerl::nanobench::doNotOptimizeAway(q->pop(out)); });
+}
+
+int main(int argc, char** argv) {
+    std::string jsonPath{"op_bench.json"};
+    for (bench::args args(argc, argv); !args.done();) {
+        if (auto v = args.value("-o"))
+            jsonPath = v;
+        else {
+            std::fprintf(stderr, "usage: op_bench [-o results.json]\n");
+            return 1;
+        }
+    }
+
+    ankerl::nanobench::Bench bench;
+    bench.warmup(1000).minEpochIterations(1'000'000).performanceCounters(true);
+
+    bench_payload<8>(bench);
+    bench_payload<32>(bench);
+    bench_payload<64>(bench);
+    bench_payload<256>(bench);
+
+    std::ofstream json(jsonPath);
+    if (!json) {
+        std::perror(jsonPath.c_str());
+        return 1;
+    }
+    ankerl::nanobench::render(ankerl::nanobench::templates::json(), bench, json);
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "affinity.h"
+#include "args.h"
+#include "detail/tsc.h"
+#include "histogram.h"
+#include "placement.h"
+#include "queue_adapters.h"
+
+// Open-loop load: the producer sends on a fixed schedule taken from the tick counter, whether or
+// not the consumer keeps up, and latency is measured from the scheduled send time. A producer
+// held up by a full queue therefore charges the wait to every message it delays instead of
+// quietly sending fewer (coordinated omission). Each queue is swept from a low rate upwards until
+// it no longer sustains the offered load, giving a latency-vs-throughput curve.
+//   openloop_bench [-r rates] [-s start-rate] [-m max-rate] [-d seconds] [-q queues] [-o csv]
+// Rates are in Mmsg/s. Without -r the sweep starts at -s (default 0.5) and steps by sqrt(2) up
+// to -m (default 200) or the first point where less than 95% of the offered load gets through.
+// The "naive p99" column is measured from the actual push instead, as a closed-loop harness would.
+
+constexpr std::size_t CAPACITY  = 1024;
+constexpr double      SATURATED = 0.95;
+
+struct Record {
+    uint64_t seq;
+    uint64_t intended;  // scheduled send, tsc
+    uint64_t sent;      // actual push, tsc
+};
+
+using histogram = nsqueue::log_linear_histogram<>;
+
+struct options {
+    std::set<double>      rates;  // empty means sweep
+    double                startRate{0.5};
+    double                maxRate{200};
+    double                seconds{0.5};
+    std::set<std::string> queues;  // empty means all
+    std::FILE*            csv{nullptr};
+};
+
+struct point {
+    double                      offered;   // Mmsg/s
+    double                      achieved;  // Mmsg/s
+    nsqueue::histogram_snapshot corrected;
+    nsqueue::histogram_snapshot naive;
+    bool                        ordered;
+};
+
+template <typename Q>
+point run_rate(Q& q, double rate, double seconds) {
+    const double   ns          = nsqueue::details::tsc_ns_per_tick();
+    const double   ticksPerMsg = 1e3 / rate / ns;
+    const uint64_t messages    = std::max<uint64_t>(1, static_cast<uint64_t>(rate * seconds * 1e6));
+
+    auto              corrected = std::make_unique<histogram>();
+    auto              naive     = std::make_unique<histogram>();
+    std::atomic<bool> ready{false};
+    bool              ordered{true};
+    uint64_t          start{0}, end{0};
+
+    std::thread consumer([&] {
+        nsqueue::pin_thread(bench::cpus().consumer);
+        while (!ready.load(std::memory_order_acquire))
+            continue;
+        Record r;
+        for (uint64_t i{}; i < messages; ++i) {
+            while (!bench::try_pop(q, r))
+                continue;
+            auto now = nsqueue::details::tsc_now();
+            corrected->record(now - r.intended);
+            naive->record(now - r.sent);
+            ordered &= r.seq == i;
+        }
+        end = nsqueue::details::tsc_now();
+    });
+
+    nsqueue::pin_thread(bench::cpus().producer);
+    start = nsqueue::details::tsc_now() + static_cast<uint64_t>(1e6 / ns);  // 1 ms lead-in
+    ready.store(true, std::memory_order_release);
+
+    Record r{};
+    for (uint64_t i{}; i < messages; ++i) {
+        r.seq      = i;
+        r.intended = start + static_cast<uint64_t>(static_cast<double>(i) * ticksPerMsg);
+        while (nsqueue::details::tsc_now() < r.intended)
+            continue;
+        r.sent = nsqueue::details::tsc_now();
+        while (!bench::try_push(q, r))
+            continue;
+    }
+    consumer.join();
+
+    const double elapsed = static_cast<double>(end - start) * ns / 1e9;
+    return {rate, static_cast<double>(messages) / elapsed / 1e6, corrected->snapshot(),
+            naive->snapshot(), ordered};
+}
+
+template <typename Make>
+void sweep(const char* name, Make make, options const& opt) {
+    if (!opt.queues.empty() && !opt.queues.count(name))
+        return;
+
+    const double ns = nsqueue::details::tsc_ns_per_tick();
+    auto         us = [&](nsqueue::histogram_snapshot const& s, double q) {
+        return static_cast<double>(q >= 1 ? s.max() : s.percentile(q)) * ns / 1e3;
+    };
+
+    std::printf("%s\n%10s %10s %10s %10s %10s %10s %10s %10s\n", name, "offered", "achieved",
+                "p50 us", "p99 us", "p99.9 us", "p99.99 us", "max us", "naive p99");
+    auto q = make();
+    for (double rate = opt.rates.empty() ? opt.startRate : *opt.rates.begin(), next{0};;
+         rate = next) {
+        auto p         = run_rate(*q, rate, opt.seconds);
+        bool saturated = p.achieved < SATURATED * p.offered;
+        std::printf("%10.2f %10.2f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f%s%s\n", p.offered,
+                    p.achieved, us(p.corrected, 0.5), us(p.corrected, 0.99),
+                    us(p.corrected, 0.999), us(p.corrected, 0.9999), us(p.corrected, 1),
+                    us(p.naive, 0.99), saturated ? "  saturated" : "",
+                    p.ordered ? "" : "  WRONG ORDER");
+        std::fflush(stdout);
+        if (opt.csv != nullptr)
+            std::fprintf(opt.csv, "%s,%.3f,%.3f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f\n", name, p.offered,
+                         p.achieved, us(p.corrected, 0.5) * 1e3, us(p.corrected, 0.99) * 1e3,
+                         us(p.corrected, 0.999) * 1e3, us(p.corrected, 0.9999) * 1e3,
+                         us(p.corrected, 1) * 1e3, us(p.naive, 0.99) * 1e3);
+
+        if (opt.rates.empty()) {
+            next = rate * 1.41421356;
+            if (saturated || next > opt.maxRate)
+                break;
+        } else {
+            auto it = opt.rates.upper_bound(rate);
+            if (it == opt.rates.end())
+                break;
+            next = *it;
+        }
+    }
+    std::printf("\n");
+}
+
+// Positive rates from a comma-separated list; empty if there are none.
+std::set<double> split_rates(const char* arg) {
+    auto rates = bench::split<double>(arg);
+    rates.erase(rates.begin(), rates.upper_bound(0));
+    return rates;
+}
+
+int main(int argc, char** argv) {
+    options     opt;
+    std::string csvPath;
+    auto        usage = [] {
+        std::fprintf(stderr, "usage: openloop_bench [-r rates] [-s start-rate] [-m max-rate] "
+                             "[-d seconds] [-q queues] [-o csv]\n");
+        return 1;
+    };
+    for (bench::args args(argc, argv); !args.done();) {
+        if (auto v = args.value("-r")) {
+            opt.rates = split_rates(v);
+            if (opt.rates.empty())
+                return usage();
+        } else if (auto v = args.value("-s"))
+            opt.startRate = std::strtod(v, nullptr);
+        else if (auto v = args.value("-m"))
+            opt.maxRate = std::strtod(v, nullptr);
+        else if (auto v = args.value("-d"))
+            opt.seconds = std::strtod(v, nullptr);
+        else if (auto v = args.value("-q"))
+            opt.queues = bench::split<std::string>(v);
+        else if (auto v = args.value("-o"))
+            csvPath = v;
+        else
+            return usage();
+    }
+    if (opt.startRate <= 0 || opt.seconds <= 0) {
+        std::fprintf(stderr, "rates and duration must be positive\n");
+        return 1;
+    }
+
+    bench::csv_file csv;
+    if (!csv.open(csvPath, "queue,offered_mmsg,achieved_mmsg,p50_ns,p99_ns,p999_ns,p9999_ns,"
+                           "max_ns,naive_p99_ns"))
+        return 1;
+    opt.csv = csv.get();
+    bench::for_each_queue_type<Record, CAPACITY>(
+        [&](const char* name, auto make) { sweep(name, make, opt); });
+    return 0;
+}
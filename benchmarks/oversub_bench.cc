@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+#include <sys/resource.h>
+
+#include "args.h"
+#include "detail/spin_wait.h"
+#include "detail/tsc.h"
+#include "histogram.h"
+#include "spsc_queue.h"
+#include "topology.h"
+
+// Runs M times as many producer/consumer threads as this process has cpus, unpinned, so the
+// scheduler has to time-slice them, and compares how the waiting side behaves when the queue is
+// full or empty:
+//   spin   busy-waits with cpu_relax() and only gives up the cpu when preempted
+//   yield  spins briefly, then calls sched_yield() between attempts
+//   park   spins briefly, then sleeps on an event_count until the other side makes progress
+//   oversub_bench [-m multipliers] [-n messages-per-pair] [-w waits]
+// e.g. oversub_bench -m 2,8 -n 50000 -w yield,park
+// Reports aggregate throughput, send-to-receive latency and the process's cpu time from
+// getrusage(), which is where spinning shows up: it burns the slices the other side needed.
+
+constexpr std::size_t CAPACITY = 1024;
+constexpr unsigned    SPINS    = 128;
+
+struct Record {
+    uint64_t seq;
+    uint64_t sent;  // tsc at push
+};
+
+using histogram = nsqueue::log_linear_histogram<>;
+using queue     = nsqueue::spsc_queue<Record, CAPACITY>;
+
+struct spin_wait {
+    static constexpr const char* name = "spin";
+
+    template <typename Try>
+    void until(Try&& attempt) noexcept {
+        while (!attempt())
+            nsqueue::details::cpu_relax();
+    }
+    void wake() noexcept {}
+};
+
+struct yield_wait {
+    static constexpr const char* name = "yield";
+
+    template <typename Try>
+    void until(Try&& attempt) noexcept {
+        for (unsigned spins{0}; !attempt();) {
+            if (spins < SPINS) {
+                ++spins;
+                nsqueue::details::cpu_relax();
+            } else {
+                ::sched_yield();
+            }
+        }
+    }
+    void wake() noexcept {}
+};
+
+struct park_wait {
+    static constexpr const char* name = "park";
+
+    template <typename Try>
+    void until(Try&& attempt) noexcept {
+        for (unsigned spins{0}; !attempt();) {
+            if (spins < SPINS) {
+                ++spins;
+                nsqueue::details::cpu_relax();
+                continue;
+            }
+            auto key = waiters_.prepare_wait();
+            if (attempt()) {
+                waiters_.cancel_wait();
+                return;
+            }
+            waiters_.wait(key);
+        }
+    }
+    void wake() noexcept { waiters_.notify_one(); }
+
+private:
+    nsqueue::details::event_count waiters_;
+};
+
+template <typename Wait>
+struct channel {
+    queue                                         queue_;
+    alignas(nsqueue::details::falseSharingSize) Wait notFull_;   // producer waits, consumer wakes
+    alignas(nsqueue::details::falseSharingSize) Wait notEmpty_;  // consumer waits, producer wakes
+    alignas(nsqueue::details::falseSharingSize) histogram latency_;
+};
+
+struct cpu_usage {
+    double seconds;  // user + system
+    long   voluntary;
+    long   involuntary;
+};
+
+cpu_usage cpu_now() {
+    rusage ru{};
+    ::getrusage(RUSAGE_SELF, &ru);
+    auto secs = [](timeval const& tv) {
+        return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) / 1e6;
+    };
+    return {secs(ru.ru_utime) + secs(ru.ru_stime), ru.ru_nvcsw, ru.ru_nivcsw};
+}
+
+template <typename Wait>
+void run(std::size_t pairs, std::size_t multiplier, std::size_t messages) {
+    std::vector<std::unique_ptr<channel<Wait>>> channels;
+    for (std::size_t p{0}; p < pairs; ++p)
+        channels.push_back(std::make_unique<channel<Wait>>());
+
+    std::atomic<std::size_t> ready{0};
+    std::atomic<bool>        go{false};
+    std::atomic<bool>        misordered{false};
+    std::vector<std::thread> threads;
+    for (std::size_t p{0}; p < pairs; ++p) {
+        auto& c = *channels[p];
+        threads.emplace_back([&] {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire))
+                std::this_thread::yield();
+            Record r{};
+            for (uint64_t i{}; i < messages; ++i) {
+                r.seq  = i;
+                r.sent = nsqueue::details::tsc_now();
+                c.notFull_.until([&] { return c.queue_.push(r); });
+                c.notEmpty_.wake();
+            }
+        });
+        threads.emplace_back([&] {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire))
+                std::this_thread::yield();
+            Record r;
+            for (uint64_t i{}; i < messages; ++i) {
+                c.notEmpty_.until([&] { return c.queue_.pop(r); });
+                c.notFull_.wake();
+                c.latency_.record(nsqueue::details::tsc_now() - r.sent);
+                if (r.seq != i)
+                    misordered.store(true, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    while (ready.load() != 2 * pairs)
+        std::this_thread::yield();
+    const auto cpu0  = cpu_now();
+    const auto start = nsqueue::details::tsc_now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads)
+        t.join();
+    const auto end  = nsqueue::details::tsc_now();
+    const auto cpu1 = cpu_now();
+
+    nsqueue::histogram_snapshot merged = channels.front()->latency_.snapshot();
+    for (std::size_t p{1}; p < pairs; ++p) {
+        auto s = channels[p]->latency_.snapshot();
+        for (std::size_t b{0}; b < merged.counts.size(); ++b)
+            merged.counts[b] += s.counts[b];
+    }
+
+    const double ns      = nsqueue::details::tsc_ns_per_tick();
+    const double wall    = static_cast<double>(end - start) * ns / 1e9;
+    const double cpu     = cpu1.seconds - cpu0.seconds;
+    const double total   = static_cast<double>(messages * pairs);
+    auto         latency = [&](double q) {
+        return static_cast<double>(merged.percentile(q)) * ns / 1e3;
+    };
+    std::printf("%-6s %2zux %4zu threads  %7.2f Mmsg/s  p50 %9.1f us  p99 %9.1f us  "
+                "p99.9 %9.1f us  cpu %7.2f s (%5.0f%% of wall, %7.1f ns/msg)  "
+                "vcsw %ld  ivcsw %ld%s\n",
+                Wait::name, multiplier, 2 * pairs, total / wall / 1e6, latency(0.5), latency(0.99),
+                latency(0.999), cpu, 100.0 * cpu / wall, cpu * 1e9 / total,
+                cpu1.voluntary - cpu0.voluntary, cpu1.involuntary - cpu0.involuntary,
+                misordered.load() ? "  WRONG ORDER" : "");
+    std::fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    std::set<std::size_t> multipliers{2, 4, 8};
+    std::size_t           messages{200'000};
+    std::set<std::string> waits{"spin", "yield", "park"};
+    for (bench::args args(argc, argv); !args.done();) {
+        if (auto v = args.value("-m"))
+            multipliers = bench::split<std::size_t>(v);
+        else if (auto v = args.value("-n"))
+            messages = std::strtoul(v, nullptr, 10);
+        else if (auto v = args.value("-w"))
+            waits = bench::split<std::string>(v);
+        else {
+            std::fprintf(stderr,
+                         "usage: oversub_bench [-m multipliers] [-n messages-per-pair] [-w waits]\n");
+            return 1;
+        }
+    }
+    multipliers.erase(0);
+    if (messages == 0 || multipliers.empty()) {
+        std::fprintf(stderr, "need at least one message per pair and a non-zero multiplier\n");
+        return 1;
+    }
+
+    const std::size_t cpus = std::max<std::size_t>(nsqueue::allowed_cpus().size(), 1);
+    std::fprintf(stderr, "%zu cpus, %zu-slot queues, %zu messages per pair\n", cpus, CAPACITY,
+                 messages);
+
+    for (auto m : multipliers) {
+        // Each pair is two threads, so m * cpus threads need m * cpus / 2 pairs.
+        const std::size_t pairs = std::max<std::size_t>(m * cpus / 2, 1);
+        if (waits.count(spin_wait::name))
+            run<spin_wait>(pairs, m, messages);
+        if (waits.count(yield_wait::name))
+            run<yield_wait>(pairs, m, messages);
+        if (waits.count(park_wait::name))
+            run<park_wait>(pairs, m, messages);
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "affinity.h"
+#include "topology.h"
+
+namespace bench {
+
+// Producer/consumer cpus for the two-thread benchmarks. NSQUEUE_BENCH_CPUS="producer,consumer"
+// overrides; otherwise two cores behind one last-level cache are picked from the cpus this
+// process may use. Falls back to leaving both threads unpinned.
+inline nsqueue::core_pair const& cpus() {
+    static const nsqueue::core_pair pair = [] {
+        nsqueue::core_pair p;
+        if (const char* env = std::getenv("NSQUEUE_BENCH_CPUS")) {
+            if (std::sscanf(env, "%d,%d", &p.producer, &p.consumer) == 2)
+                return p;
+            std::fprintf(stderr, "ignoring malformed NSQUEUE_BENCH_CPUS=%s\n", env);
+        }
+        try {
+            auto topo = nsqueue::topology::discover();
+            if (auto rec = topo.recommend_pair(nsqueue::placement::shared_cache,
+                                               nsqueue::allowed_cpus()))
+                p = *rec;
+        } catch (std::exception const& e) {
+            std::fprintf(stderr, "topology discovery failed: %s\n", e.what());
+        }
+        std::fprintf(stderr, "producer cpu %d, consumer cpu %d\n", p.producer, p.consumer);
+        return p;
+    }();
+    return pair;
+}
+
+// Up to `count` producer/consumer pairs on disjoint physical cores for multi-queue benchmarks:
+// pairs behind a shared last-level cache first, then pairs within one NUMA node. Returns an
+// empty list when the topology cannot be read.
+inline std::vector<nsqueue::core_pair> disjoint_pairs(std::size_t count) {
+    std::vector<nsqueue::core_pair> pairs;
+    try {
+        auto topo    = nsqueue::topology::discover();
+        auto allowed = nsqueue::allowed_cpus();
+        for (auto where : {nsqueue::placement::shared_cache, nsqueue::placement::same_node}) {
+            if (pairs.size() == count)
+                break;
+            // Leave out every cpu of a core that an earlier pair already uses.
+            std::vector<int> rest;
+            for (int cpu : allowed) {
+                auto const* info = topo.find(cpu);
+                bool        used = std::any_of(pairs.begin(), pairs.end(), [&](auto const& p) {
+                    return info != nullptr
+                        && (topo.find(p.producer)->core == info->core
+                            || topo.find(p.consumer)->core == info->core);
+                });
+                if (!used)
+                    rest.push_back(cpu);
+            }
+            if (rest.empty())
+                break;
+            for (auto const& p : topo.recommend_pairs(count - pairs.size(), where, rest))
+                pairs.push_back(p);
+        }
+    } catch (std::exception const& e) {
+        std::fprintf(stderr, "topology discovery failed: %s\n", e.what());
+    }
+    return pairs;
+}
+
+// Sends 0..messages-1 through force_push on where.producer to force_pop on where.consumer.
+// Throws std::runtime_error if either thread could not be pinned; the consumer terminates the
+// program if the values arrive out of order.
+template <typename Queue>
+void force_round_trip(Queue& q, nsqueue::core_pair where, std::uint64_t messages) {
+    std::atomic<bool> ready{false};
+    bool              consumerPinned{false};
+    std::thread       consumer = std::thread([&] {
+        consumerPinned = nsqueue::pin_thread(where.consumer);
+        while (!ready.load(std::memory_order_acquire))
+            continue;
+        for (std::uint64_t i{}; i < messages; ++i) {
+            std::uint64_t val;
+            q.force_pop(val);
+            if (val != i)
+                throw std::runtime_error("wrong ordering");
+        }
+    });
+
+    const bool producerPinned = nsqueue::pin_thread(where.producer);
+    ready.store(true, std::memory_order_release);
+    for (std::uint64_t i{}; i < messages; ++i)
+        q.force_push(i);
+    consumer.join();
+
+    if (!producerPinned || !consumerPinned)
+        throw std::runtime_error(
+            "cannot run on cpu " + std::to_string(producerPinned ? where.consumer : where.producer));
+}
+
+}  // namespace bench
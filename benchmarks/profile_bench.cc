@@ -0,0 +1,99 @@
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <nanobench.h>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "hardware_profile.h"
+#include "placement.h"
+#include "spsc_queue.h"
+#include "topology.h"
+
+// Runs spsc_queue under each hardware profile on a set of producer/consumer core pairs, e.g.
+//   profile_bench sibling:0,32 socket:0,2 cross:0,16
+// where each argument is label:producer,consumer. Without arguments one pair of each kind the
+// machine offers (SMT sibling, shared cache, same node, cross node) is taken from its topology.
+constexpr std::size_t N        = 1'000'000;
+constexpr std::size_t CAPACITY = 1 << 12;
+
+using line_only = nsqueue::hardware_profile<64, 64, 64, false>;
+
+struct labelled_pair {
+    std::string        label;
+    nsqueue::core_pair cpus;
+};
+
+std::vector<labelled_pair> topology_pairs() {
+    const std::pair<nsqueue::placement, const char*> kinds[] = {
+        {nsqueue::placement::smt_sibling, "sibling"},
+        {nsqueue::placement::shared_cache, "shared cache"},
+        {nsqueue::placement::same_node, "same node"},
+        {nsqueue::placement::cross_node, "cross node"},
+    };
+    std::vector<labelled_pair> pairs;
+    try {
+        auto topo    = nsqueue::topology::discover();
+        auto allowed = nsqueue::allowed_cpus();
+        for (auto [where, label] : kinds) {
+            if (auto p = topo.recommend_pair(where, allowed))
+                pairs.push_back({label, *p});
+        }
+    } catch (std::exception const& e) {
+        std::fprintf(stderr, "topology discovery failed: %s\n", e.what());
+    }
+    return pairs;
+}
+
+template <typename Profile>
+void run_profile(ankerl::nanobench::Bench& bench, const char* name, nsqueue::core_pair cpus) {
+    using queue = nsqueue::spsc_queue<uint64_t, CAPACITY, std::allocator<uint64_t>, Profile>;
+    auto q      = std::make_unique<queue>();
+    bench.run(name, [&] { bench::force_round_trip(*q, cpus, N); });
+}
+
+int main(int argc, char** argv) {
+    std::vector<labelled_pair> pairs;
+    for (int i{1}; i < argc; ++i) {
+        labelled_pair p;
+        std::string   arg(argv[i]);
+        auto          colon = arg.find(':');
+        auto          comma = arg.find(',', colon);
+        if (colon == std::string::npos || comma == std::string::npos) {
+            std::fprintf(stderr, "expected label:producer,consumer, got %s\n", argv[i]);
+            return 1;
+        }
+        p.label         = arg.substr(0, colon);
+        p.cpus.producer = std::stoi(arg.substr(colon + 1, comma - colon - 1));
+        p.cpus.consumer = std::stoi(arg.substr(comma + 1));
+        pairs.push_back(p);
+    }
+    if (pairs.empty())
+        pairs = topology_pairs();
+    if (pairs.empty())
+        pairs.push_back({"unpinned", {}});
+
+    for (auto const& [label, cpus] : pairs) {
+        ankerl::nanobench::Bench bench;
+        bench.title(label + " (" + std::to_string(cpus.producer) + " -> "
+                    + std::to_string(cpus.consumer) + ")")
+            .unit("msg")
+            .batch(N)
+            .warmup(3)
+            .epochs(20)
+            .performanceCounters(true);
+
+        try {
+            run_profile<nsqueue::profiles::native>(bench, "native", cpus);
+            run_profile<line_only>(bench, "64-byte separation", cpus);
+            run_profile<nsqueue::profiles::smt_sibling<>>(bench, "smt_sibling", cpus);
+        } catch (std::exception const& e) {
+            std::fprintf(stderr, "%s: %s\n", label.c_str(), e.what());
+            return 1;
+        }
+    }
+
+    return 0;
+}
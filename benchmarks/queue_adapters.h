@@ -0,0 +1,70 @@
+#pragma once
+
+#include <boost/lockfree/spsc_queue.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <utility>
+
+#include "deaod/spsc_queue.h"
+#include "dro/spsc_queue.h"
+#include "moodycamel/spsc_queue.h"
+#include "mutex/spsc_queue.h"
+#include "spsc_queue.h"
+
+// Uniform non-blocking push/pop over the queue implementations in benchmarks/, so that harnesses
+// can be written once. mutex_queue has no non-blocking pop; its pop waits for an element.
+namespace bench {
+
+template <typename Q, typename T>
+bool try_push(Q& q, T const& v) {
+    if constexpr (requires { q.try_push(v); })
+        return q.try_push(v);
+    else if constexpr (requires { q.try_enqueue(v); })
+        return q.try_enqueue(v);
+    else
+        return q.push(v);
+}
+
+template <typename Q, typename T>
+bool try_pop(Q& q, T& v) {
+    if constexpr (requires { q.try_pop(v); })
+        return q.try_pop(v);
+    else if constexpr (requires { q.try_dequeue(v); })
+        return q.try_dequeue(v);
+    else
+        return q.pop(v);
+}
+
+// Calls func(name, make) for every implementation, where make() returns a unique_ptr to a fresh
+// instance sized to hold Capacity - 1 elements, except nsqueue, which uses all Capacity slots.
+template <typename T, std::size_t Capacity, typename F>
+void for_each_queue_type(F&& func) {
+    func("mutex", [] { return std::make_unique<mutex_queue<T>>(Capacity); });
+    func("boost", [] { return std::make_unique<boost::lockfree::spsc_queue<T>>(Capacity); });
+    func("deaod", [] { return std::make_unique<deaod::spsc_queue<T, Capacity>>(); });
+    func("dro", [] {
+        // dro keeps at most 2 MB inline; N = 0 selects its heap buffer.
+        if constexpr (requires { typename dro::SPSCQueue<T, Capacity - 1>; })
+            return std::make_unique<dro::SPSCQueue<T, Capacity - 1>>();
+        else
+            return std::make_unique<dro::SPSCQueue<T, 0>>(Capacity - 1);
+    });
+    func("moodycamel", [] {
+        return std::make_unique<moodycamel::BlockingReaderWriterCircularBuffer<T>>(Capacity);
+    });
+    func("nsqueue", [] { return std::make_unique<nsqueue::spsc_queue<T, Capacity>>(); });
+}
+
+// Calls func(name, queue) once for a fresh instance of every implementation.
+template <typename T, std::size_t Capacity, typename F>
+void for_each_queue(F&& func) {
+    for_each_queue_type<T, Capacity>([&](const char* name, auto make) {
+        auto q = make();
+        func(name, *q);
+    });
+}
+
+}  // namespace bench
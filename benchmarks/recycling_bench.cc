@@ -0,0 +1,107 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <nanobench.h>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include "affinity.h"
+#include "placement.h"
+#include "recycling_channel.h"
+#include "spsc_queue.h"
+
+constexpr std::size_t N        = 1'000'000;
+constexpr std::size_t CAPACITY = 1 << 12;
+
+struct Message {
+    uint64_t seq{};
+    char     payload[248]{};
+};
+
+template <typename Produce, typename Consume>
+void run_pair(Produce&& produce, Consume&& consume) {
+    std::atomic<bool> ready{false};
+    std::thread       consumer = std::thread([&] {
+        nsqueue::pin_thread(bench::cpus().consumer);
+        while (!ready.load(std::memory_order_acquire))
+            continue;
+        for (uint64_t i{}; i < N; ++i) {
+            if (consume() != i) {
+                throw std::runtime_error("wrong ordering");
+            }
+        }
+    });
+
+    nsqueue::pin_thread(bench::cpus().producer);
+
+    ready.store(true, std::memory_order_release);
+
+    for (uint64_t i{}; i < N; ++i) {
+        produce(i);
+    }
+    consumer.join();
+}
+
+void bench_recycling(nsqueue::recycling_channel<Message, CAPACITY>& ch) {
+    run_pair(
+        [&](uint64_t i) {
+            while (!ch.produce([i](Message& m) { m.seq = i; }))
+                continue;
+        },
+        [&] {
+            Message* m;
+            while ((m = ch.receive()) == nullptr)
+                continue;
+            auto seq = m->seq;
+            ch.release(m);
+            return seq;
+        });
+}
+
+void bench_new_delete(nsqueue::spsc_queue<std::unique_ptr<Message>, CAPACITY>& q) {
+    run_pair(
+        [&](uint64_t i) {
+            auto m = std::make_unique<Message>();
+            m->seq = i;
+            q.force_emplace(std::move(m));
+        },
+        [&] {
+            std::unique_ptr<Message> m;
+            q.force_pop(m);
+            return m->seq;
+        });
+}
+
+void bench_malloc_free(nsqueue::spsc_queue<Message*, CAPACITY>& q) {
+    run_pair(
+        [&](uint64_t i) {
+            auto* m = new (std::malloc(sizeof(Message))) Message{};
+            m->seq  = i;
+            q.force_push(m);
+        },
+        [&] {
+            Message* m;
+            q.force_pop(m);
+            auto seq = m->seq;
+            std::free(m);
+            return seq;
+        });
+}
+
+int main() {
+    auto channel_   = std::make_unique<nsqueue::recycling_channel<Message, CAPACITY>>();
+    auto unique_q_  = std::make_unique<nsqueue::spsc_queue<std::unique_ptr<Message>, CAPACITY>>();
+    auto pointer_q_ = std::make_unique<nsqueue::spsc_queue<Message*, CAPACITY>>();
+
+    ankerl::nanobench::Bench bench;
+    bench.warmup(10).epochs(100).minEpochIterations(10).performanceCounters(true);
+    bench.title("256B messages").unit("msg").batch(N);
+
+    bench.run("new/delete", [&] { bench_new_delete(*unique_q_); });
+    bench.run("malloc/free", [&] { bench_malloc_free(*pointer_q_); });
+    bench.run("recycling_channel", [&] { bench_recycling(*channel_); });
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "affinity.h"
+#include "placement.h"
+#include "queue_adapters.h"
+#include "traffic_trace.h"
+
+constexpr std::size_t CAPACITY = 1 << 12;
+
+using clock_type = std::chrono::steady_clock;
+
+struct Message {
+    int64_t  intended_ns;
+    uint64_t seq;
+};
+
+inline int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               clock_type::now().time_since_epoch())
+        .count();
+}
+
+// Microbursts of back-to-back messages on top of a Poisson background, used when no recorded
+// trace is given on the command line.
+nsqueue::traffic_trace synthetic_trace(std::size_t messages) {
+    std::mt19937_64                  rng(42);
+    std::exponential_distribution<>  gap(1.0 / 2'000.0);
+    std::uniform_int_distribution<>  burst(32, 512);
+    nsqueue::traffic_trace           trace;
+    double                           t{0};
+    while (trace.enqueues.size() < messages) {
+        t += gap(rng);
+        if (rng() % 64 == 0) {
+            for (int i = burst(rng); i > 0 && trace.enqueues.size() < messages; --i) {
+                t += 5;
+                trace.enqueues.push_back({static_cast<uint64_t>(t), sizeof(Message)});
+            }
+        } else {
+            trace.enqueues.push_back({static_cast<uint64_t>(t), sizeof(Message)});
+        }
+    }
+    return trace;
+}
+
+struct replay_result {
+    std::vector<int64_t> latency_ns;
+    int64_t              wall_ns;
+};
+
+template <typename Q>
+replay_result replay(Q& q, const std::vector<nsqueue::trace_event>& arrivals) {
+    const auto        n = arrivals.size();
+    replay_result     result{std::vector<int64_t>(n), 0};
+    std::atomic<bool> ready{false};
+
+    std::thread consumer([&] {
+        nsqueue::pin_thread(bench::cpus().consumer);
+        while (!ready.load(std::memory_order_acquire))
+            continue;
+        for (uint64_t i{}; i < n; ++i) {
+            Message m;
+            while (!bench::try_pop(q, m))
+                continue;
+            if (m.seq != i)
+                throw std::runtime_error("wrong ordering");
+            result.latency_ns[i] = now_ns() - m.intended_ns;
+        }
+    });
+
+    nsqueue::pin_thread(bench::cpus().producer);
+    const int64_t t0 = now_ns() + 1'000'000;
+    ready.store(true, std::memory_order_release);
+
+    for (uint64_t i{}; i < n; ++i) {
+        const int64_t intended = t0 + static_cast<int64_t>(arrivals[i].time_ns);
+        while (now_ns() < intended)
+            continue;
+        Message m{intended, i};
+        while (!bench::try_push(q, m))
+            continue;
+    }
+    consumer.join();
+    result.wall_ns = now_ns() - t0;
+    return result;
+}
+
+int64_t percentile(std::vector<int64_t>& v, double p) {
+    auto k = static_cast<std::size_t>(p * static_cast<double>(v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(k), v.end());
+    return v[k];
+}
+
+int main(int argc, char** argv) {
+    nsqueue::traffic_trace trace = argc > 1 ? nsqueue::traffic_trace::load(argv[1])
+                                            : synthetic_trace(500'000);
+    if (trace.enqueues.empty()) {
+        std::fprintf(stderr, "trace has no enqueue events\n");
+        return 1;
+    }
+
+    std::printf("replaying %zu arrivals over %.3f ms\n",
+                trace.enqueues.size(),
+                static_cast<double>(trace.enqueues.back().time_ns) / 1e6);
+    std::printf("| %-12s | %10s | %10s | %10s | %10s | %10s |\n",
+                "queue", "p50 ns", "p99 ns", "p99.9 ns", "max ns", "wall ms");
+
+    bench::for_each_queue<Message, CAPACITY>([&](const char* name, auto& q) {
+        auto r = replay(q, trace.enqueues);
+        std::printf("| %-12s | %10lld | %10lld | %10lld | %10lld | %10.3f |\n",
+                    name,
+                    static_cast<long long>(percentile(r.latency_ns, 0.50)),
+                    static_cast<long long>(percentile(r.latency_ns, 0.99)),
+                    static_cast<long long>(percentile(r.latency_ns, 0.999)),
+                    static_cast<long long>(*std::max_element(r.latency_ns.begin(), r.latency_ns.end())),
+                    static_cast<double>(r.wall_ns) / 1e6);
+    });
+
+    return 0;
+}
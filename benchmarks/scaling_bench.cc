@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "affinity.h"
+#include "args.h"
+#include "detail/tsc.h"
+#include "hardware_profile.h"
+#include "histogram.h"
+#include "placement.h"
+#include "queue_adapters.h"
+
+// Runs 1..K independent producer/consumer pairs at once, each pair on its own physical cores
+// and with its own queue, to show how aggregate throughput scales when pairs compete for the
+// last-level cache and memory bandwidth. Pair counts double up to K.
+//   scaling_bench [-k pairs] [-n messages-per-pair] [-p payloads] [-c capacities] [-q queues]
+// e.g. scaling_bench -k 20 -p 16,256 -c 1024 -q nsqueue,nsqueue-packed,dro
+// Payloads are chosen from 16, 64 and 256 bytes and capacities from 1024 and 16384; queues
+// default to every implementation in benchmarks/ plus nsqueue-packed, an spsc_queue whose slots
+// are not padded to the false-sharing distance. Latency is send-to-receive time under
+// saturation, i.e. mostly time spent queued.
+
+template <std::size_t Bytes>
+struct Record {
+    static_assert(Bytes >= 16);
+    uint64_t                     seq;
+    uint64_t                     sent;  // tsc at push
+    std::array<char, Bytes - 16> payload;
+};
+
+using histogram   = nsqueue::log_linear_histogram<>;
+using packed_slot = nsqueue::hardware_profile<nsqueue::profiles::native::cache_line,
+                                              nsqueue::profiles::native::false_sharing, 1, false>;
+
+struct options {
+    std::size_t                     maxPairs{0};
+    std::size_t                     messages{1'000'000};
+    std::set<std::size_t>           payloads{16, 64, 256};
+    std::set<std::size_t>           capacities{1024, 16384};
+    std::set<std::string>           queues;  // empty means all
+    std::vector<nsqueue::core_pair> cpus;
+};
+
+struct pair_result {
+    double                      mmsgPerSec;
+    nsqueue::histogram_snapshot latency;    // ticks
+    bool                        pinFailed;  // a thread could not be moved to its cpu
+};
+
+template <typename Record, typename Make>
+std::vector<pair_result> run_pairs(Make& make, std::vector<nsqueue::core_pair> const& cpus,
+                                   std::size_t messages, bool& ordered) {
+    const std::size_t                       k = cpus.size();
+    std::vector<decltype(make())>           queues;
+    std::vector<std::unique_ptr<histogram>> latency;
+    std::vector<std::uint64_t>              end(k);
+    for (std::size_t p{0}; p < k; ++p) {
+        queues.push_back(make());
+        latency.push_back(std::make_unique<histogram>());
+    }
+
+    std::atomic<std::size_t>       ready{0};
+    std::atomic<bool>              go{false};
+    std::atomic<bool>              misordered{false};
+    std::vector<std::atomic<bool>> pinFailed(k);
+    std::vector<std::thread>       threads;
+    for (std::size_t p{0}; p < k; ++p) {
+        threads.emplace_back([&, p] {
+            if (!nsqueue::pin_thread(cpus[p].producer))
+                pinFailed[p].store(true);
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire))
+                continue;
+            Record r{};
+            for (uint64_t i{}; i < messages; ++i) {
+                r.seq  = i;
+                r.sent = nsqueue::details::tsc_now();
+                while (!bench::try_push(*queues[p], r))
+                    continue;
+            }
+        });
+        threads.emplace_back([&, p] {
+            if (!nsqueue::pin_thread(cpus[p].consumer))
+                pinFailed[p].store(true);
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire))
+                continue;
+            Record r;
+            for (uint64_t i{}; i < messages; ++i) {
+                while (!bench::try_pop(*queues[p], r))
+                    continue;
+                latency[p]->record(nsqueue::details::tsc_now() - r.sent);
+                if (r.seq != i)
+                    misordered.store(true, std::memory_order_relaxed);
+            }
+            end[p] = nsqueue::details::tsc_now();
+        });
+    }
+
+    while (ready.load() != 2 * k)
+        std::this_thread::yield();
+    const auto start = nsqueue::details::tsc_now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads)
+        t.join();
+
+    ordered &= !misordered.load();
+    std::vector<pair_result> results;
+    for (std::size_t p{0}; p < k; ++p) {
+        double seconds = static_cast<double>(end[p] - start) * nsqueue::details::tsc_ns_per_tick()
+                       / 1e9;
+        results.push_back({static_cast<double>(messages) / seconds / 1e6, latency[p]->snapshot(),
+                           pinFailed[p].load()});
+    }
+    return results;
+}
+
+template <typename Record, typename Make>
+void run_queue(const char* name, Make make, std::size_t capacity, options const& opt) {
+    if (!opt.queues.empty() && !opt.queues.count(name))
+        return;
+
+    const double             ns = nsqueue::details::tsc_ns_per_tick();
+    double                   single{0};
+    std::vector<std::size_t> steps;
+    for (std::size_t k{1}; k < opt.cpus.size(); k *= 2)
+        steps.push_back(k);
+    steps.push_back(opt.cpus.size());
+
+    for (auto k : steps) {
+        std::vector<nsqueue::core_pair> cpus(opt.cpus.begin(), opt.cpus.begin() + k);
+        bool                            ordered{true};
+        auto                            results = run_pairs<Record>(make, cpus, opt.messages, ordered);
+
+        double                      total{0}, lo{1e300}, hi{0};
+        std::size_t                 pinFailures{0};
+        nsqueue::histogram_snapshot merged = results.front().latency;
+        for (std::size_t p{0}; p < results.size(); ++p) {
+            pinFailures += results[p].pinFailed;
+            total += results[p].mmsgPerSec;
+            lo = std::min(lo, results[p].mmsgPerSec);
+            hi = std::max(hi, results[p].mmsgPerSec);
+            if (p > 0)
+                for (std::size_t b{0}; b < merged.counts.size(); ++b)
+                    merged.counts[b] += results[p].latency.counts[b];
+        }
+        if (k == 1)
+            single = total;
+
+        std::printf("%-15s %5zuB %6zu %3zu pairs  total %8.2f Mmsg/s  per pair %7.2f..%-7.2f  "
+                    "scaling %5.1f%%  p50 %8.0f ns  p99 %9.0f ns%s%s\n",
+                    name, sizeof(Record), capacity, k, total, lo, hi,
+                    100.0 * total / (single * static_cast<double>(k)),
+                    static_cast<double>(merged.percentile(0.5)) * ns,
+                    static_cast<double>(merged.percentile(0.99)) * ns,
+                    ordered ? "" : "  WRONG ORDER", pinFailures > 0 ? "  PIN FAILED" : "");
+        // A pair whose threads could not be pinned is marked even when it is the only one, so
+        // its numbers are not mistaken for a pinned run.
+        if (k > 1 || pinFailures > 0) {
+            for (std::size_t p{0}; p < results.size(); ++p)
+                std::printf("    pair %2zu (%d -> %d)  %8.2f Mmsg/s  p50 %8.0f ns  "
+                            "p99 %9.0f ns%s\n",
+                            p, cpus[p].producer, cpus[p].consumer, results[p].mmsgPerSec,
+                            static_cast<double>(results[p].latency.percentile(0.5)) * ns,
+                            static_cast<double>(results[p].latency.percentile(0.99)) * ns,
+                            results[p].pinFailed ? "  not pinned" : "");
+        }
+        std::fflush(stdout);
+    }
+}
+
+template <std::size_t Bytes, std::size_t Capacity>
+void run_config(options const& opt) {
+    if (!opt.payloads.count(Bytes) || !opt.capacities.count(Capacity))
+        return;
+    using record = Record<Bytes>;
+    bench::for_each_queue_type<record, Capacity>(
+        [&](const char* name, auto make) { run_queue<record>(name, make, Capacity, opt); });
+    run_queue<record>(
+        "nsqueue-packed",
+        [] {
+            return std::make_unique<
+                nsqueue::spsc_queue<record, Capacity, std::allocator<record>, packed_slot>>();
+        },
+        Capacity, opt);
+}
+
+int main(int argc, char** argv) {
+    options opt;
+    for (bench::args args(argc, argv); !args.done();) {
+        if (auto v = args.value("-k"))
+            opt.maxPairs = std::strtoul(v, nullptr, 10);
+        else if (auto v = args.value("-n"))
+            opt.messages = std::strtoul(v, nullptr, 10);
+        else if (auto v = args.value("-p"))
+            opt.payloads = bench::split<std::size_t>(v);
+        else if (auto v = args.value("-c"))
+            opt.capacities = bench::split<std::size_t>(v);
+        else if (auto v = args.value("-q"))
+            opt.queues = bench::split<std::string>(v);
+        else {
+            std::fprintf(stderr, "usage: scaling_bench [-k pairs] [-n messages-per-pair] "
+                                 "[-p payloads] [-c capacities] [-q queues]\n");
+            return 1;
+        }
+    }
+    if (opt.messages == 0) {
+        std::fprintf(stderr, "need at least one message per pair\n");
+        return 1;
+    }
+
+    opt.cpus = bench::disjoint_pairs(opt.maxPairs == 0 ? 1024 : opt.maxPairs);
+    if (opt.cpus.empty() || opt.cpus.size() < opt.maxPairs) {
+        std::fprintf(stderr, "only %zu disjoint core pairs available, running the rest unpinned\n",
+                     opt.cpus.size());
+        opt.cpus.resize(std::max<std::size_t>(opt.maxPairs, 1), nsqueue::core_pair{});
+    }
+    for (auto const& p : opt.cpus)
+        std::fprintf(stderr, "pair %d -> %d\n", p.producer, p.consumer);
+
+    run_config<16, 1024>(opt);
+    run_config<16, 16384>(opt);
+    run_config<64, 1024>(opt);
+    run_config<64, 16384>(opt);
+    run_config<256, 1024>(opt);
+    run_config<256, 16384>(opt);
+    return 0;
+}
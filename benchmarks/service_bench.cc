@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "affinity.h"
+#include "args.h"
+#include "detail/tsc.h"
+#include "histogram.h"
+#include "placement.h"
+#include "spsc_queue.h"
+
+// Producer inter-arrival gaps and consumer per-message work drawn from configurable
+// distributions, so queue capacity can be sized against a realistic service-time profile
+// instead of the infinitely fast consumer of spsc_bench. Work is simulated by spinning on the
+// tick counter, calibrated against steady_clock at startup.
+//   service_bench [-a arrival -s service] [-n messages] [-c capacities] [-o timeline.csv]
+// A distribution is one of
+//   const:MEAN                 always MEAN ns
+//   exp:MEAN                   exponential with mean MEAN ns
+//   bimodal:FAST,SLOW,P        SLOW ns with probability P, otherwise FAST ns
+//   pareto:MEAN,ALPHA          Pareto with mean MEAN ns and shape ALPHA > 1
+// e.g. service_bench -a exp:1000 -s bimodal:500,5000,0.05 -c 64,1024
+// Capacities are chosen from 64, 1024 and 16384 slots.
+// Without -a/-s every service distribution is run at about 80% load with exponential arrivals.
+// Reports achieved throughput, end-to-end latency (scheduled arrival to the end of service),
+// queue depth as seen by the consumer, and depth over time in 1 ms windows. Arrivals keep to
+// their schedule while the queue is full, so time spent waiting to push counts as latency.
+
+constexpr std::uint64_t WINDOW_NS = 1'000'000;
+
+struct Record {
+    uint64_t seq;
+    uint64_t sent;  // scheduled arrival tsc
+};
+
+using histogram = nsqueue::log_linear_histogram<>;
+
+struct distribution {
+    enum class kind { constant, exponential, bimodal, pareto };
+
+    kind        kind_{kind::constant};
+    double      a_{0}, b_{0}, c_{0};
+    std::string text_;
+
+    static distribution parse(std::string const& text) {
+        distribution d;
+        d.text_    = text;
+        auto colon = text.find(':');
+        if (colon == std::string::npos)
+            throw std::invalid_argument("distribution needs kind:parameters: " + text);
+        auto kind = text.substr(0, colon);
+        int  n    = std::sscanf(text.c_str() + colon + 1, "%lf,%lf,%lf", &d.a_, &d.b_, &d.c_);
+        if (kind == "const" && n == 1 && d.a_ >= 0)
+            d.kind_ = kind::constant;
+        else if (kind == "exp" && n == 1 && d.a_ > 0)
+            d.kind_ = kind::exponential;
+        else if (kind == "bimodal" && n == 3 && d.a_ >= 0 && d.b_ >= 0 && d.c_ >= 0 && d.c_ <= 1)
+            d.kind_ = kind::bimodal;
+        else if (kind == "pareto" && n == 2 && d.a_ > 0 && d.b_ > 1)
+            d.kind_ = kind::pareto;
+        else
+            throw std::invalid_argument("bad distribution: " + text);
+        return d;
+    }
+
+    [[nodiscard]] double mean() const noexcept {
+        return kind_ == kind::bimodal ? (1 - c_) * a_ + c_ * b_ : a_;
+    }
+
+    // n samples converted to ticks, drawn up front so the hot loops only read an array.
+    [[nodiscard]] std::vector<std::uint64_t> ticks(std::size_t n, std::mt19937_64& rng) const {
+        const double                           perTick = nsqueue::details::tsc_ns_per_tick();
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        std::vector<std::uint64_t>             out(n);
+        for (auto& t : out) {
+            double ns{a_};
+            switch (kind_) {
+            case kind::constant:
+                break;
+            case kind::exponential:
+                ns = -a_ * std::log(1.0 - uniform(rng));
+                break;
+            case kind::bimodal:
+                ns = uniform(rng) < c_ ? b_ : a_;
+                break;
+            case kind::pareto:
+                // Scale chosen so that the mean is a_.
+                ns = a_ * (b_ - 1) / b_ / std::pow(1.0 - uniform(rng), 1.0 / b_);
+                break;
+            }
+            t = static_cast<std::uint64_t>(ns / perTick);
+        }
+        return out;
+    }
+};
+
+struct scenario {
+    std::string  name;
+    distribution arrival;
+    distribution service;
+};
+
+struct options {
+    std::size_t           messages{200'000};
+    std::set<std::size_t> capacities{64, 1024, 16384};
+    std::string           csvPath;
+};
+
+struct window {
+    std::uint64_t sum{0}, count{0}, max{0};
+};
+
+inline void spin_until(std::uint64_t deadline) noexcept {
+    while (nsqueue::details::tsc_now() < deadline)
+        continue;
+}
+
+template <std::size_t Capacity>
+void run(scenario const& s, options const& opt, std::FILE* csv) {
+    using queue = nsqueue::spsc_queue<Record, Capacity>;
+
+    std::mt19937_64 rng(42);
+    const auto      gaps        = s.arrival.ticks(opt.messages, rng);
+    const auto      service     = s.service.ticks(opt.messages, rng);
+    const double    ns          = nsqueue::details::tsc_ns_per_tick();
+    const auto      windowTicks = static_cast<std::uint64_t>(WINDOW_NS / ns);
+
+    auto                q       = std::make_unique<queue>();
+    auto                latency = std::make_unique<histogram>();
+    auto                depth   = std::make_unique<histogram>();
+    std::vector<window> timeline;
+    std::atomic<bool>   ready{false};
+    std::atomic<bool>   misordered{false};
+    std::uint64_t       start{0}, end{0}, fullPushes{0};
+
+    std::thread consumer([&] {
+        nsqueue::pin_thread(bench::cpus().consumer);
+        while (!ready.load(std::memory_order_acquire))
+            continue;
+        Record r;
+        window current;
+        auto   windowEnd = start + windowTicks;
+        for (uint64_t i{}; i < opt.messages; ++i) {
+            while (!q->pop(r))
+                continue;
+            auto now = nsqueue::details::tsc_now();
+            auto d   = q->size() + 1;  // including the one just taken
+            depth->record(d);
+            while (now >= windowEnd) {
+                timeline.push_back(current);
+                current = {};
+                windowEnd += windowTicks;
+            }
+            current.sum += d;
+            current.count += 1;
+            current.max = std::max<std::uint64_t>(current.max, d);
+
+            spin_until(now + service[i]);
+            latency->record(nsqueue::details::tsc_now() - r.sent);
+            if (r.seq != i)
+                misordered.store(true, std::memory_order_relaxed);
+        }
+        timeline.push_back(current);
+        end = nsqueue::details::tsc_now();
+    });
+
+    nsqueue::pin_thread(bench::cpus().producer);
+    start = nsqueue::details::tsc_now();
+    ready.store(true, std::memory_order_release);
+
+    // Arrivals follow an absolute timeline, as in openloop_bench, so that push cost and waits on
+    // a full queue do not stretch the gaps and lower the offered rate.
+    Record   r{};
+    uint64_t next{start};
+    for (uint64_t i{}; i < opt.messages; ++i) {
+        next += gaps[i];
+        spin_until(next);
+        r.seq  = i;
+        r.sent = next;
+        if (!q->push(r)) {
+            ++fullPushes;
+            while (!q->push(r))
+                continue;
+        }
+    }
+    consumer.join();
+
+    const double seconds = static_cast<double>(end - start) * ns / 1e9;
+    const double offered = 1e3 / s.arrival.mean();
+    const double load    = s.service.mean() / s.arrival.mean();
+    auto         lat     = latency->snapshot();
+    auto         dep     = depth->snapshot();
+    auto         us      = [&](double q) {
+        return static_cast<double>(lat.percentile(q)) * ns / 1e3;
+    };
+
+    std::printf("%-12s %6zu slots  offered %6.3f Mmsg/s (load %3.0f%%)  achieved %6.3f Mmsg/s  "
+                "full %5.2f%%%s\n",
+                s.name.c_str(), Capacity, offered, 100.0 * load,
+                static_cast<double>(opt.messages) / seconds / 1e6,
+                100.0 * static_cast<double>(fullPushes) / static_cast<double>(opt.messages),
+                misordered.load() ? "  WRONG ORDER" : "");
+    std::printf("    latency p50 %9.1f us  p99 %9.1f us  p99.9 %9.1f us  max %9.1f us\n", us(0.5),
+                us(0.99), us(0.999), static_cast<double>(lat.max()) * ns / 1e3);
+    // Bucket bounds can overshoot the capacity.
+    auto slots = [&](std::uint64_t v) {
+        return static_cast<unsigned long long>(std::min<std::uint64_t>(v, Capacity));
+    };
+    std::printf("    depth   p50 %6llu  p99 %6llu  max %6llu\n", slots(dep.percentile(0.5)),
+                slots(dep.percentile(0.99)), slots(dep.max()));
+
+    // Depth over time, folded into at most 16 columns for the terminal.
+    const std::size_t columns = std::min<std::size_t>(16, timeline.size());
+    std::printf("    max depth over time:");
+    for (std::size_t c{0}; c < columns; ++c) {
+        std::uint64_t m{0};
+        for (std::size_t w = c * timeline.size() / columns;
+             w < (c + 1) * timeline.size() / columns; ++w)
+            m = std::max(m, timeline[w].max);
+        std::printf(" %llu", static_cast<unsigned long long>(m));
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+
+    if (csv != nullptr)
+        for (std::size_t w{0}; w < timeline.size(); ++w)
+            std::fprintf(csv, "%s,%s,%s,%zu,%zu,%.1f,%llu\n", s.name.c_str(),
+                         s.arrival.text_.c_str(), s.service.text_.c_str(), Capacity, w,
+                         timeline[w].count == 0 ? 0.0
+                                                : static_cast<double>(timeline[w].sum)
+                                                      / static_cast<double>(timeline[w].count),
+                         static_cast<unsigned long long>(timeline[w].max));
+}
+
+void run_capacities(scenario const& s, options const& opt, std::FILE* csv) {
+    if (opt.capacities.count(64))
+        run<64>(s, opt, csv);
+    if (opt.capacities.count(1024))
+        run<1024>(s, opt, csv);
+    if (opt.capacities.count(16384))
+        run<16384>(s, opt, csv);
+}
+
+void usage() {
+    std::fprintf(stderr, "usage: service_bench [-a arrival -s service] [-n messages] "
+                         "[-c capacities] [-o timeline.csv]\n");
+}
+
+int main(int argc, char** argv) {
+    options               opt;
+    std::string           arrival, service;
+    std::vector<scenario> scenarios;
+    try {
+        for (bench::args args(argc, argv); !args.done();) {
+            if (auto v = args.value("-a"))
+                arrival = v;
+            else if (auto v = args.value("-s"))
+                service = v;
+            else if (auto v = args.value("-n"))
+                opt.messages = std::strtoul(v, nullptr, 10);
+            else if (auto v = args.value("-c"))
+                opt.capacities = bench::split<std::size_t>(v);
+            else if (auto v = args.value("-o"))
+                opt.csvPath = v;
+            else {
+                usage();
+                return 1;
+            }
+        }
+        if (arrival.empty() != service.empty()) {
+            usage();
+            return 1;
+        }
+        if (!arrival.empty()) {
+            scenarios.push_back(
+                {"custom", distribution::parse(arrival), distribution::parse(service)});
+        } else {
+            // Mean service 800 ns against a mean gap of 1 us.
+            auto poisson = distribution::parse("exp:1000");
+            scenarios.push_back({"constant", distribution::parse("const:1000"),
+                                 distribution::parse("const:800")});
+            scenarios.push_back({"exponential", poisson, distribution::parse("exp:800")});
+            scenarios.push_back({"bimodal", poisson, distribution::parse("bimodal:400,4400,0.1")});
+            scenarios.push_back({"pareto", poisson, distribution::parse("pareto:800,1.5")});
+        }
+    } catch (std::exception const& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    if (opt.messages == 0) {
+        std::fprintf(stderr, "need at least one message\n");
+        return 1;
+    }
+
+    bench::csv_file csv;
+    if (!csv.open(opt.csvPath,
+                  "scenario,arrival,service,capacity,window_ms,depth_mean,depth_max"))
+        return 1;
+    for (auto const& s : scenarios)
+        run_capacities(s, opt, csv.get());
+    return 0;
+}
@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "affinity.h"
+#include "args.h"
+#include "detail/tsc.h"
+#include "histogram.h"
+#include "placement.h"
+#include "spsc_queue.h"
+
+// Runs one producer/consumer pair flat out for minutes to hours and cuts the consumer's view
+// into 1 ms windows: messages dequeued and the largest gap between consecutive dequeues. Any
+// window whose largest gap exceeds the threshold is printed as it happens, with CLOCK_MONOTONIC
+// and UTC timestamps of the gap, so it can be lined up with dmesg, ftrace or perf (which use the
+// monotonic clock) and with logs. Periodic events such as THP compaction, SMIs and timer ticks
+// show up here long before a short benchmark would hit them.
+//   soak_bench [-d duration] [-t stall-us] [-r report-seconds] [-o windows.csv]
+// Duration takes an s, m or h suffix (default 60s). -o writes every window: some 30 bytes per
+// row and 3.6 million rows per hour, so about 110 MB per hour.
+
+constexpr std::size_t   CAPACITY  = 4096;
+constexpr std::size_t   WINDOWS   = 1 << 16;  // windows buffered for the reporting thread
+constexpr std::uint64_t WINDOW_NS = 1'000'000;
+
+struct window_stat {
+    std::uint64_t start;     // tsc
+    std::uint64_t messages;  // dequeued in this window
+    std::uint64_t maxGap;    // ticks
+    std::uint64_t gapEnd;    // tsc of the dequeue that ended maxGap
+};
+
+using queue        = nsqueue::spsc_queue<std::uint64_t, CAPACITY>;
+using window_queue = nsqueue::spsc_queue<window_stat, WINDOWS>;
+using histogram    = nsqueue::log_linear_histogram<>;
+
+// Maps ticks to CLOCK_MONOTONIC nanoseconds. The rate is re-fitted on every update() from the
+// first and latest anchors, so it stays accurate to well under a window over long runs.
+class clock_map {
+public:
+    clock_map() : tsc0_(nsqueue::details::tsc_now()), mono0_(monotonic_ns()) {
+        real0_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+    }
+
+    void update() {
+        auto tsc  = nsqueue::details::tsc_now();
+        auto mono = monotonic_ns();
+        if (tsc > tsc0_ && mono - mono0_ > 1'000'000'000)
+            nsPerTick_ = static_cast<double>(mono - mono0_) / static_cast<double>(tsc - tsc0_);
+    }
+
+    [[nodiscard]] std::int64_t monotonic(std::uint64_t tick) const {
+        return mono0_
+             + static_cast<std::int64_t>(
+                   static_cast<double>(static_cast<std::int64_t>(tick - tsc0_)) * nsPerTick_);
+    }
+
+    [[nodiscard]] std::int64_t realtime(std::uint64_t tick) const {
+        return real0_ + (monotonic(tick) - mono0_);
+    }
+
+    [[nodiscard]] double ns_per_tick() const noexcept { return nsPerTick_; }
+
+private:
+    static std::int64_t monotonic_ns() {
+        timespec ts{};
+        ::clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<std::int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+    }
+
+    std::uint64_t tsc0_;
+    std::int64_t  mono0_;
+    std::int64_t  real0_;
+    double        nsPerTick_{nsqueue::details::tsc_ns_per_tick()};
+};
+
+// "2026-10-17T09:30:12.123456Z"
+std::string utc(std::int64_t ns) {
+    std::time_t secs = static_cast<std::time_t>(ns / 1'000'000'000);
+    std::tm     tm{};
+    ::gmtime_r(&secs, &tm);
+    char buf[64];
+    auto n = std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    std::snprintf(buf + n, sizeof(buf) - n, ".%06lldZ",
+                  static_cast<long long>(ns % 1'000'000'000 / 1'000));
+    return buf;
+}
+
+bool parse_duration(const char* arg, double& seconds) {
+    char*  unit{};
+    double v = std::strtod(arg, &unit);
+    if (unit == arg || v <= 0)
+        return false;
+    if (*unit == '\0' || std::strcmp(unit, "s") == 0)
+        seconds = v;
+    else if (std::strcmp(unit, "m") == 0)
+        seconds = v * 60;
+    else if (std::strcmp(unit, "h") == 0)
+        seconds = v * 3600;
+    else
+        return false;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    double      duration{60}, stallUs{20}, reportSeconds{10};
+    std::string csvPath;
+    auto        usage = [] {
+        std::fprintf(stderr, "usage: soak_bench [-d duration[s|m|h]] [-t stall-us] "
+                             "[-r report-seconds] [-o windows.csv]\n");
+        return 1;
+    };
+    for (bench::args args(argc, argv); !args.done();) {
+        if (auto v = args.value("-d")) {
+            if (!parse_duration(v, duration))
+                return usage();
+        } else if (auto v = args.value("-t"))
+            stallUs = std::strtod(v, nullptr);
+        else if (auto v = args.value("-r"))
+            reportSeconds = std::strtod(v, nullptr);
+        else if (auto v = args.value("-o"))
+            csvPath = v;
+        else
+            return usage();
+    }
+
+    bench::csv_file csv;
+    if (!csv.open(csvPath, "monotonic_ns,messages,max_gap_ns,stall"))
+        return 1;
+
+    auto                  q       = std::make_unique<queue>();
+    auto                  windows = std::make_unique<window_queue>();
+    std::atomic<bool>     stop{false};
+    std::atomic<bool>     misordered{false};
+    std::atomic<uint64_t> droppedWindows{0};
+    clock_map             clock;
+    const double          ns          = clock.ns_per_tick();
+    const auto            windowTicks = static_cast<std::uint64_t>(WINDOW_NS / ns);
+    const auto            stallTicks  = static_cast<std::uint64_t>(stallUs * 1e3 / ns);
+
+    std::thread consumer([&] {
+        nsqueue::pin_thread(bench::cpus().consumer);
+        window_stat current{nsqueue::details::tsc_now(), 0, 0, 0};
+        auto        last      = current.start;
+        auto        windowEnd = current.start + windowTicks;
+        uint64_t    expected{0}, v;
+        for (;;) {
+            if (!q->pop(v)) {
+                if (stop.load(std::memory_order_relaxed)) [[unlikely]]
+                    break;
+                continue;
+            }
+            auto now = nsqueue::details::tsc_now();
+            while (now >= windowEnd) {
+                if (!windows->push(current))
+                    droppedWindows.fetch_add(1, std::memory_order_relaxed);
+                current   = {windowEnd, 0, 0, 0};
+                windowEnd += windowTicks;
+            }
+            if (now - last > current.maxGap) {
+                current.maxGap = now - last;
+                current.gapEnd = now;
+            }
+            last = now;
+            ++current.messages;
+            if (v != expected++)
+                misordered.store(true, std::memory_order_relaxed);
+        }
+    });
+
+    std::thread producer([&] {
+        nsqueue::pin_thread(bench::cpus().producer);
+        for (uint64_t i{0}; !stop.load(std::memory_order_relaxed); ++i)
+            while (!q->push(i))
+                continue;
+    });
+
+    // This thread drains the windows, reports and stops the run.
+    const auto    begin      = std::chrono::steady_clock::now();
+    auto          nextReport = begin + std::chrono::duration<double>(reportSeconds);
+    auto          gaps       = std::make_unique<histogram>();
+    auto          rates      = std::make_unique<histogram>();  // messages per window
+    std::uint64_t total{0}, count{0}, stalls{0}, worstGap{0};
+    std::uint64_t periodMessages{0}, periodWindows{0}, periodMin{~0ull};
+    auto drain = [&] {
+        window_stat w;
+        while (windows->pop(w)) {
+            ++count;
+            total += w.messages;
+            gaps->record(w.maxGap);
+            rates->record(w.messages);
+            worstGap = std::max(worstGap, w.maxGap);
+            periodMessages += w.messages;
+            periodMin = std::min(periodMin, w.messages);
+            ++periodWindows;
+            const bool stall = w.maxGap > stallTicks;
+            if (stall) {
+                ++stalls;
+                auto from = w.gapEnd - w.maxGap;
+                auto mono = clock.monotonic(from);
+                std::printf("STALL %9.1f us  from monotonic %lld.%06lld s  (%s)  window %llu  "
+                            "%llu msgs\n",
+                            static_cast<double>(w.maxGap) * clock.ns_per_tick() / 1e3,
+                            static_cast<long long>(mono / 1'000'000'000),
+                            static_cast<long long>(mono % 1'000'000'000 / 1'000),
+                            utc(clock.realtime(from)).c_str(),
+                            static_cast<unsigned long long>(count - 1),
+                            static_cast<unsigned long long>(w.messages));
+            }
+            if (csv.get() != nullptr)
+                std::fprintf(csv.get(), "%lld,%llu,%.0f,%d\n",
+                             static_cast<long long>(clock.monotonic(w.start)),
+                             static_cast<unsigned long long>(w.messages),
+                             static_cast<double>(w.maxGap) * clock.ns_per_tick(), stall ? 1 : 0);
+        }
+    };
+
+    const auto end = begin + std::chrono::duration<double>(duration);
+    while (std::chrono::steady_clock::now() < end) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        clock.update();
+        drain();
+        if (std::chrono::steady_clock::now() >= nextReport && periodWindows > 0) {
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin)
+                              .count();
+            std::printf("%8.0f s  mean %8.2f Mmsg/s  worst window %8.2f Mmsg/s  max gap %9.1f us  "
+                        "stalls %llu\n",
+                        secs,
+                        static_cast<double>(periodMessages) / static_cast<double>(periodWindows)
+                            / 1e3,
+                        static_cast<double>(periodMin) / 1e3,
+                        static_cast<double>(worstGap) * clock.ns_per_tick() / 1e3,
+                        static_cast<unsigned long long>(stalls));
+            std::fflush(stdout);
+            periodMessages = periodWindows = 0;
+            periodMin                      = ~0ull;
+            nextReport += std::chrono::duration<double>(reportSeconds);
+        }
+    }
+    stop.store(true, std::memory_order_relaxed);
+    producer.join();
+    consumer.join();
+    drain();
+
+    // Windows hold 1 ms, so messages per window / 1e3 is Mmsg/s.
+    auto r      = rates->snapshot();
+    auto g      = gaps->snapshot();
+    auto mmsg   = [](std::uint64_t perWindow) { return static_cast<double>(perWindow) / 1e3; };
+    auto micros = [&](std::uint64_t ticks) {
+        return static_cast<double>(ticks) * clock.ns_per_tick() / 1e3;
+    };
+    std::printf("\n%llu windows, %llu messages, %llu stalls over %.1f us%s\n",
+                static_cast<unsigned long long>(count), static_cast<unsigned long long>(total),
+                static_cast<unsigned long long>(stalls), stallUs,
+                misordered.load() ? "  WRONG ORDER" : "");
+    std::printf("throughput per window  p0.01 %8.2f  p1 %8.2f  p50 %8.2f Mmsg/s\n",
+                mmsg(r.percentile(0.0001)), mmsg(r.percentile(0.01)), mmsg(r.percentile(0.5)));
+    std::printf("max gap per window     p50 %8.1f  p99 %8.1f  p99.99 %8.1f  max %8.1f us\n",
+                micros(g.percentile(0.5)), micros(g.percentile(0.99)),
+                micros(g.percentile(0.9999)), micros(worstGap));
+    if (auto dropped = droppedWindows.load())
+        std::printf("%llu windows dropped by the reporting thread\n",
+                    static_cast<unsigned long long>(dropped));
+    return 0;
+}
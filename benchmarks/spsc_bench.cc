@@ -4,6 +4,7 @@
 #include <chrono>
 #include <condition_variable>
 #include <cstdint>
+#include <cstdio>
 #include <immintrin.h>
 #include <iostream>
 #include <mutex>
@@ -13,70 +14,25 @@
 #include <queue>
 #include <thread>
 
+#include "affinity.h"
 #include "deaod/spsc_queue.h"
 #include "dro/spsc_queue.h"
+#include "masked/spsc_queue.h"
 #include "moodycamel/spsc_queue.h"
 #include "mutex/spsc_queue.h"
+#include "placement.h"
 #include "spsc_queue.h"
 
-#define CONSUMER_CPU 1
-#define PRODUCER_CPU 3
-
 constexpr std::size_t N        = 1'000'000;
 constexpr std::size_t CAPACITY = 1 << 12;
-
-inline void pinThread(std::thread& t, int cpu) {
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(cpu, &cpuset);
-    int rc = pthread_setaffinity_np(t.native_handle(), sizeof(cpu_set_t), &cpuset);
-    if (rc != 0)
-        throw std::runtime_error("Failed to pin thread");
-}
-
-inline void pinThread(int cpu) {
-    if (cpu < 0)
-        return;
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(cpu, &cpuset);
-    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) == -1) {
-        perror("pthread_setaffinity_no");
-        exit(1);
-    }
-}
-
-template <typename T>
-void bench_force(T& buffer) {
-    std::atomic<bool> ready{false};
-    std::thread       consumer = std::thread([&] {
-        pinThread(CONSUMER_CPU);
-        while (!ready.load(std::memory_order_acquire))
-            continue;
-        for (uint64_t i{}; i < N; ++i) {
-            uint64_t val;
-            buffer.force_pop(val);
-            if (val != i) {
-                throw std::runtime_error("wrong ordering");
-            }
-        }
-    });
-
-    pinThread(PRODUCER_CPU);
-
-    ready.store(true, std::memory_order_release);
-
-    for (uint64_t i{}; i < N; ++i) {
-        buffer.force_push(i);
-    }
-    consumer.join();
-}
+// A capacity that would otherwise have to be rounded up to CAPACITY.
+constexpr std::size_t ODD_CAPACITY = 3000;
 
 template <typename T>
 void bench_force_dro(T& buffer) {
     std::atomic<bool> ready{false};
     std::thread       consumer = std::thread([&] {
-        pinThread(CONSUMER_CPU);
+        nsqueue::pin_thread(bench::cpus().consumer);
         while (!ready.load(std::memory_order_acquire))
             continue;
         for (uint64_t i{}; i < N; ++i) {
@@ -88,7 +44,7 @@ void bench_force_dro(T& buffer) {
         }
     });
 
-    pinThread(PRODUCER_CPU);
+    nsqueue::pin_thread(bench::cpus().producer);
 
     ready.store(true, std::memory_order_release);
 
@@ -101,7 +57,7 @@ template <typename T>
 void bench_force_moodycamel(T& buffer) {
     std::atomic<bool> ready{false};
     std::thread       consumer = std::thread([&] {
-        pinThread(CONSUMER_CPU);
+        nsqueue::pin_thread(bench::cpus().consumer);
         while (!ready.load(std::memory_order_acquire))
             continue;
         for (uint64_t i{}; i < N; ++i) {
@@ -113,7 +69,7 @@ void bench_force_moodycamel(T& buffer) {
         }
     });
 
-    pinThread(PRODUCER_CPU);
+    nsqueue::pin_thread(bench::cpus().producer);
 
     ready.store(true, std::memory_order_release);
 
@@ -127,7 +83,7 @@ template <typename T>
 void bench_try(T& buffer) {
     std::atomic<bool> ready{false};
     std::thread       consumer = std::thread([&] {
-        pinThread(CONSUMER_CPU);
+        nsqueue::pin_thread(bench::cpus().consumer);
         while (!ready.load(std::memory_order_acquire))
             continue;
         for (uint64_t i{}; i < N; ++i) {
@@ -140,7 +96,7 @@ void bench_try(T& buffer) {
         }
     });
 
-    pinThread(PRODUCER_CPU);
+    nsqueue::pin_thread(bench::cpus().producer);
 
     ready.store(true, std::memory_order_release);
 
@@ -155,7 +111,7 @@ template <typename T>
 void bench_try_dro(T& buffer) {
     std::atomic<bool> ready{false};
     std::thread       consumer = std::thread([&] {
-        pinThread(CONSUMER_CPU);
+        nsqueue::pin_thread(bench::cpus().consumer);
         while (!ready.load(std::memory_order_acquire))
             continue;
         for (uint64_t i{}; i < N; ++i) {
@@ -168,7 +124,7 @@ void bench_try_dro(T& buffer) {
         }
     });
 
-    pinThread(PRODUCER_CPU);
+    nsqueue::pin_thread(bench::cpus().producer);
 
     ready.store(true, std::memory_order_release);
 
@@ -183,7 +139,7 @@ template <typename T>
 void bench_try_moodycamel(T& buffer) {
     std::atomic<bool> ready{false};
     std::thread       consumer = std::thread([&] {
-        pinThread(CONSUMER_CPU);
+        nsqueue::pin_thread(bench::cpus().consumer);
         while (!ready.load(std::memory_order_acquire))
             continue;
         for (uint64_t i{}; i < N; ++i) {
@@ -196,7 +152,7 @@ void bench_try_moodycamel(T& buffer) {
         }
     });
 
-    pinThread(PRODUCER_CPU);
+    nsqueue::pin_thread(bench::cpus().producer);
 
     ready.store(true, std::memory_order_release);
 
@@ -207,6 +163,24 @@ void bench_try_moodycamel(T& buffer) {
     consumer.join();
 }
 
+// Producer and consumer on one thread with the ring kept half full, so every call takes the
+// cached-index fast path. Isolates the cost of the index arithmetic itself.
+template <typename T>
+void bench_hot_path(ankerl::nanobench::Bench& bench, const char* name, T& buffer) {
+    const uint64_t half = buffer.capacity() / 2;
+    for (uint64_t i{}; i < half; ++i)
+        buffer.force_push(i);
+
+    uint64_t next{half}, val{}, occupancy{};
+    bench.run(name, [&] {
+        buffer.force_push(next++);
+        buffer.force_pop(val);
+        occupancy += buffer.size();
+    });
+    ankerl::nanobench::doNotOptimizeAway(val);
+    ankerl::nanobench::doNotOptimizeAway(occupancy);
+}
+
 int main() {
 
     using object = uint64_t;
@@ -217,6 +191,11 @@ int main() {
     dro::SPSCQueue<object, CAPACITY - 1>                   dro_queue_;
     moodycamel::BlockingReaderWriterCircularBuffer<object> moodycamel_queue_(CAPACITY);
     nsqueue::spsc_queue<object, CAPACITY>                  nsqueue_;
+    masked::spsc_queue<object, CAPACITY>                   masked_queue_;
+    nsqueue::spsc_queue<object, ODD_CAPACITY>              nsqueue_odd_;
+    nsqueue::spsc_queue<object, CAPACITY, std::allocator<object>, nsqueue::profiles::native,
+                        nsqueue::dwell_sampling<64>>
+        nsqueue_sampled_;
 
     ankerl::nanobench::Bench bench;
     bench.warmup(10).epochs(100).minEpochIterations(10).performanceCounters(true);
@@ -225,7 +204,25 @@ int main() {
     // bench.run("deaod", [&] { bench_try(deaod_queue_); });
     bench.run("dro", [&] { bench_force_dro(dro_queue_); });
     // bench.run("moodycamel", [&] { bench_force_moodycamel(moodycamel_queue_); });
-    bench.run("nsqueue", [&] { bench_force(nsqueue_); });
+    auto force = [](auto& q) { bench::force_round_trip(q, bench::cpus(), N); };
+    bench.run("nsqueue", [&] { force(nsqueue_); });
+    bench.run("nsqueue (masked cursors)", [&] { force(masked_queue_); });
+    bench.run("nsqueue (N=3000)", [&] { force(nsqueue_odd_); });
+    bench.run("nsqueue (dwell sampling 1/64)", [&] { force(nsqueue_sampled_); });
+
+    ankerl::nanobench::Bench hot;
+    hot.title("single-thread push/pop/size").minEpochIterations(1'000'000).performanceCounters(true);
+    bench_hot_path(hot, "nsqueue", nsqueue_);
+    bench_hot_path(hot, "nsqueue (masked cursors)", masked_queue_);
+    bench_hot_path(hot, "nsqueue (N=3000)", nsqueue_odd_);
+    bench_hot_path(hot, "nsqueue (dwell sampling 1/64)", nsqueue_sampled_);
+
+    auto dwell = nsqueue_sampled_.dwell_histogram().snapshot();
+    std::printf("dwell sampling: %llu samples, p50 %llu ns, p99 %llu ns, max %llu ns\n",
+                static_cast<unsigned long long>(dwell.total()),
+                static_cast<unsigned long long>(dwell.percentile(0.5)),
+                static_cast<unsigned long long>(dwell.percentile(0.99)),
+                static_cast<unsigned long long>(dwell.max()));
 
     return 0;
 }
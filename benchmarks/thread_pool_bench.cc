@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <nanobench.h>
+#include <thread>
+
+#include "mutex/thread_pool.h"
+#include "thread_pool.h"
+
+using namespace std::chrono_literals;
+
+constexpr std::size_t SMALL_TASKS = 100'000;
+constexpr std::size_t LARGE_TASKS = 2'000;
+
+inline void busy_for(std::chrono::nanoseconds d) {
+    auto deadline = std::chrono::steady_clock::now() + d;
+    while (std::chrono::steady_clock::now() < deadline)
+        continue;
+}
+
+template <typename Pool>
+void bench_tasks(Pool& pool, std::size_t tasks, std::chrono::nanoseconds work) {
+    std::atomic<std::size_t> done{0};
+    for (std::size_t i{0}; i < tasks; ++i) {
+        pool.submit([&done, work] {
+            busy_for(work);
+            done.fetch_add(1, std::memory_order_release);
+        });
+    }
+    while (done.load(std::memory_order_acquire) != tasks)
+        std::this_thread::yield();
+}
+
+int main() {
+    const std::size_t threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+    nsqueue::thread_pool nsqueue_pool(threads);
+    mutex_thread_pool    mutex_pool(threads);
+
+    ankerl::nanobench::Bench bench;
+    bench.warmup(2).epochs(20).minEpochIterations(1).performanceCounters(true);
+
+    bench.title("100ns tasks").unit("task").batch(SMALL_TASKS);
+    bench.run("mutex", [&] { bench_tasks(mutex_pool, SMALL_TASKS, 100ns); });
+    bench.run("nsqueue", [&] { bench_tasks(nsqueue_pool, SMALL_TASKS, 100ns); });
+
+    bench.title("100us tasks").unit("task").batch(LARGE_TASKS);
+    bench.run("mutex", [&] { bench_tasks(mutex_pool, LARGE_TASKS, 100us); });
+    bench.run("nsqueue", [&] { bench_tasks(nsqueue_pool, LARGE_TASKS, 100us); });
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <nanobench.h>
+
+#include "placement.h"
+#include "spsc_queue.h"
+
+// Built twice: usdt_bench without probes and usdt_bench_probed with NSQUEUE_ENABLE_USDT (when
+// <sys/sdt.h> is available). With nothing attached the two should be indistinguishable; run the
+// probed binary under one of the scripts in tools/bpftrace to see the cost of an attached probe.
+constexpr std::size_t N        = 1'000'000;
+constexpr std::size_t CAPACITY = 1 << 10;
+
+using queue = nsqueue::spsc_queue<uint64_t, CAPACITY>;
+
+int main() {
+#if defined(NSQUEUE_ENABLE_USDT) && NSQUEUE_ENABLE_USDT
+    std::printf("probes compiled in\n");
+#else
+    std::printf("probes compiled out\n");
+#endif
+    auto q = std::make_unique<queue>();
+
+    ankerl::nanobench::Bench single;
+    single.title("single thread").minEpochIterations(1'000'000).performanceCounters(true);
+
+    uint64_t next{}, val{};
+    single.run("push/pop", [&] {
+        (void)q->push(next++);
+        (void)q->pop(val);
+    });
+    // Every operation takes the slow path: push_full / pop_empty after a failed refresh.
+    for (std::size_t i{}; i < CAPACITY; ++i)
+        (void)q->push(i);
+    single.run("push on full", [&] { ankerl::nanobench::doNotOptimizeAway(q->push(next)); });
+    q->consume_all([](uint64_t) {});
+    single.run("pop on empty", [&] { ankerl::nanobench::doNotOptimizeAway(q->pop(val)); });
+    single.run("consume_all batch of 8", [&] {
+        for (uint64_t i{}; i < 8; ++i)
+            (void)q->push(i);
+        q->consume_all([&](uint64_t v) { val += v; });
+    });
+    ankerl::nanobench::doNotOptimizeAway(val);
+
+    ankerl::nanobench::Bench cross;
+    cross.title("two threads").unit("msg").batch(N).warmup(3).epochs(20).performanceCounters(true);
+    // A small ring, so producer and consumer refresh their caches and wait in force_push /
+    // force_pop often.
+    cross.run("force_push/force_pop", [&] { bench::force_round_trip(*q, bench::cpus(), N); });
+
+    return 0;
+}
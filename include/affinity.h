@@ -0,0 +1,47 @@
+#pragma once
+
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace nsqueue {
+
+namespace details {
+
+#if defined(__linux__)
+// The one place threads get pinned; pin_thread() and apply_placement() both go through it.
+inline bool pin_thread(pthread_t thread, int cpu) noexcept {
+    if (cpu < 0)
+        return true;
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    return pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuset) == 0;
+}
+#endif
+
+}  // namespace details
+
+// Pins a thread to a single cpu. Returns false if the cpu is invalid or the platform does not
+// support affinity; a negative cpu is treated as "leave unpinned" and succeeds.
+inline bool pin_thread(std::thread& t, int cpu) noexcept {
+#if defined(__linux__)
+    return details::pin_thread(t.native_handle(), cpu);
+#else
+    (void)t;
+    return cpu < 0;
+#endif
+}
+
+inline bool pin_thread(int cpu) noexcept {
+#if defined(__linux__)
+    return details::pin_thread(pthread_self(), cpu);
+#else
+    return cpu < 0;
+#endif
+}
+
+}  // namespace nsqueue
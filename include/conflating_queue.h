@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include "detail/cache_utils.h"
+#include "detail/spin_wait.h"
+#include "spsc_queue.h"
+
+namespace nsqueue {
+
+// Last-value-wins SPSC queue keyed by a small integer. The producer overwrites the pending value
+// for a key in place; the ring only carries keys that went from clean to dirty, so it can never
+// overflow and the consumer does work proportional to the number of distinct dirty keys.
+//
+// Values are published through a per-key seqlock, which is why T must be trivially copyable.
+template <typename T, std::size_t Keys>
+class conflating_queue {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+    static_assert(Keys > 0, "Keys must be positive");
+
+public:
+    using key_type = std::uint32_t;
+    using index_t  = std::size_t;
+
+    conflating_queue()
+        : slots_(std::make_unique<Slot[]>(Keys)) {}
+    conflating_queue(const conflating_queue& other)            = delete;
+    conflating_queue& operator=(const conflating_queue& other) = delete;
+    conflating_queue(conflating_queue&& other)                 = delete;
+    conflating_queue& operator=(conflating_queue&& other)      = delete;
+    ~conflating_queue()                                        = default;
+
+    // Producer side. Never fails: either the key is already queued and its value is replaced, or
+    // the key is enqueued into a ring that has room for every key. key must be below Keys.
+    void push(key_type key, T const& value) noexcept {
+        assert(key < Keys);
+        auto& slot = slots_[key];
+        auto  seq  = slot.seq_.load(std::memory_order_relaxed);
+
+        slot.seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&slot.value_, &value, sizeof(T));
+        slot.seq_.store(seq + 2, std::memory_order_release);
+
+        if (!slot.pending_.exchange(true, std::memory_order_acq_rel))
+            dirty_.force_push(key);
+    }
+
+    // Consumer side. Returns the latest value of the oldest dirty key.
+    [[nodiscard]] bool pop(key_type& key, T& value) noexcept {
+        if (!dirty_.pop(key))
+            return false;
+
+        auto& slot = slots_[key];
+        // Clear before reading so that an update racing with the read re-queues the key.
+        slot.pending_.exchange(false, std::memory_order_acq_rel);
+        read(slot, value);
+        return true;
+    }
+
+    template <typename F>
+    bool consume_one(F&& func) noexcept {
+        key_type key;
+        T        value;
+        if (!pop(key, value))
+            return false;
+        func(key, static_cast<T const&>(value));
+        return true;
+    }
+
+    template <typename F>
+    index_t consume_all(F&& func) noexcept {
+        index_t n{0};
+        while (consume_one(std::forward<F>(func)))
+            ++n;
+        return n;
+    }
+
+    [[nodiscard]] index_t size() const noexcept { return dirty_.size(); }
+
+    [[nodiscard]] bool empty() const noexcept { return dirty_.empty(); }
+
+    [[nodiscard]] static constexpr index_t keys() noexcept { return Keys; }
+
+private:
+    struct alignas(details::falseSharingSize) Slot {
+        std::atomic<std::uint32_t> seq_{0};
+        std::atomic<bool>          pending_{false};
+        T                          value_{};
+    };
+
+    static void read(Slot const& slot, T& value) noexcept {
+        for (;;) {
+            auto before = slot.seq_.load(std::memory_order_acquire);
+            if (before & 1) {
+                details::cpu_relax();
+                continue;
+            }
+            std::memcpy(&value, &slot.value_, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq_.load(std::memory_order_relaxed) == before)
+                return;
+        }
+    }
+
+    std::unique_ptr<Slot[]>                         slots_;
+    spsc_queue<key_type, std::bit_ceil(Keys)>       dirty_;
+};
+
+}  // namespace nsqueue
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <atomic>
+
+// The atomic template the queues build their cursors from. A test build may define
+// NSQUEUE_ATOMIC to an instrumented template with std::atomic's interface (tests/model_checker.h
+// provides one) before the first nsqueue include. Every translation unit in a program has to
+// agree on it, so set it for the whole target rather than per file.
+#ifndef NSQUEUE_ATOMIC
+#define NSQUEUE_ATOMIC std::atomic
+#endif
+
+namespace nsqueue::details {
+
+template <typename T>
+using atomic = NSQUEUE_ATOMIC<T>;
+
+}  // namespace nsqueue::details
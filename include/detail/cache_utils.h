@@ -4,14 +4,14 @@
 #include <new>
 #include <type_traits>
 
+#include "hardware_profile.h"
+
 namespace nsqueue::details 
 {
 
-#if defined(__cpp_lib_hardward_interference_size)
-constexpr std::size_t cacheLineSize = std::hardward_destructive_interference_size;
-#else
-constexpr std::size_t cacheLineSize = 64;
-#endif
+constexpr std::size_t cacheLineSize    = profiles::native::cache_line;
+// Distance to keep between state owned by different threads, e.g. producer and consumer.
+constexpr std::size_t falseSharingSize = profiles::native::false_sharing;
 
 #if defined(__GNUC__) || defined(__clang__)
 #define NSQ_LIKELY(x) __builtin_expect(!!(x), 1)
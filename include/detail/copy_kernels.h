@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NSQ_X86 1
+#endif
+
+// Batches at or above this many bytes are written into the ring with non-temporal stores when
+// the caller leaves the choice to the queue. Define to SIZE_MAX to never stream automatically.
+#ifndef NSQUEUE_STREAMING_THRESHOLD
+#define NSQUEUE_STREAMING_THRESHOLD (256 * 1024)
+#endif
+
+namespace nsqueue {
+
+enum class store_hint {
+    automatic,  // stream when the batch is at least NSQUEUE_STREAMING_THRESHOLD bytes
+    cached,     // regular stores
+    streaming,  // non-temporal stores, bypassing the producer's caches
+};
+
+namespace details {
+
+// Copies `count` records of `bytes` bytes between strided buffers. Streaming stores are only
+// used for the 32/64-byte aligned body of each destination record; the caller must issue
+// store_fence() before publishing data written with stream == true.
+using copy_records_fn = void (*)(std::byte*       dst,
+                                 std::size_t      dstStride,
+                                 const std::byte* src,
+                                 std::size_t      srcStride,
+                                 std::size_t      bytes,
+                                 std::size_t      count,
+                                 bool             stream) noexcept;
+
+inline void copy_records_scalar(std::byte*       dst,
+                                std::size_t      dstStride,
+                                const std::byte* src,
+                                std::size_t      srcStride,
+                                std::size_t      bytes,
+                                std::size_t      count,
+                                bool             stream) noexcept {
+    for (std::size_t r{0}; r < count; ++r, dst += dstStride, src += srcStride) {
+        std::size_t i{0};
+#if defined(NSQ_X86) && defined(__SSE2__)
+        if (stream && (reinterpret_cast<std::uintptr_t>(dst) & 15) == 0) {
+            for (; i + 16 <= bytes; i += 16)
+                _mm_stream_si128(reinterpret_cast<__m128i*>(dst + i),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        }
+#else
+        (void)stream;
+#endif
+        std::memcpy(dst + i, src + i, bytes - i);
+    }
+}
+
+#if defined(NSQ_X86) && (defined(__GNUC__) || defined(__clang__))
+#define NSQ_HAVE_VECTOR_KERNELS 1
+
+__attribute__((target("avx2"))) inline void copy_records_avx2(std::byte*       dst,
+                                                              std::size_t      dstStride,
+                                                              const std::byte* src,
+                                                              std::size_t      srcStride,
+                                                              std::size_t      bytes,
+                                                              std::size_t      count,
+                                                              bool             stream) noexcept {
+    for (std::size_t r{0}; r < count; ++r, dst += dstStride, src += srcStride) {
+        std::size_t i{0};
+        if (stream && (reinterpret_cast<std::uintptr_t>(dst) & 31) == 0) {
+            for (; i + 32 <= bytes; i += 32)
+                _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + i),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+        } else {
+            for (; i + 32 <= bytes; i += 32)
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+        }
+        std::memcpy(dst + i, src + i, bytes - i);
+    }
+}
+
+__attribute__((target("avx512f"))) inline void copy_records_avx512(std::byte*       dst,
+                                                                   std::size_t      dstStride,
+                                                                   const std::byte* src,
+                                                                   std::size_t      srcStride,
+                                                                   std::size_t      bytes,
+                                                                   std::size_t      count,
+                                                                   bool stream) noexcept {
+    for (std::size_t r{0}; r < count; ++r, dst += dstStride, src += srcStride) {
+        std::size_t i{0};
+        if (stream && (reinterpret_cast<std::uintptr_t>(dst) & 63) == 0) {
+            for (; i + 64 <= bytes; i += 64)
+                _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + i),
+                                    _mm512_loadu_si512(src + i));
+        } else {
+            for (; i + 64 <= bytes; i += 64)
+                _mm512_storeu_si512(dst + i, _mm512_loadu_si512(src + i));
+        }
+        std::memcpy(dst + i, src + i, bytes - i);
+    }
+}
+#endif
+
+enum class copy_isa { scalar, avx2, avx512 };
+
+inline copy_isa detect_copy_isa() noexcept {
+#if defined(NSQ_HAVE_VECTOR_KERNELS)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return copy_isa::avx512;
+    if (__builtin_cpu_supports("avx2"))
+        return copy_isa::avx2;
+#endif
+    return copy_isa::scalar;
+}
+
+inline copy_records_fn copy_kernel(copy_isa isa) noexcept {
+    switch (isa) {
+#if defined(NSQ_HAVE_VECTOR_KERNELS)
+    case copy_isa::avx512:
+        return &copy_records_avx512;
+    case copy_isa::avx2:
+        return &copy_records_avx2;
+#endif
+    default:
+        return &copy_records_scalar;
+    }
+}
+
+// Resolved once per process from CPUID.
+inline copy_records_fn copy_records() noexcept {
+    static const copy_records_fn fn = copy_kernel(detect_copy_isa());
+    return fn;
+}
+
+inline void store_fence() noexcept {
+#if defined(NSQ_X86)
+    _mm_sfence();
+#endif
+}
+
+}  // namespace details
+
+}  // namespace nsqueue
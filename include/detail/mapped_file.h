@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nsqueue::details {
+
+[[noreturn]] inline void throw_errno(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+inline std::size_t page_size() noexcept {
+    static const auto size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+// Called with the file, offset and length of every mapped_file::sync(), before it is carried
+// out. Lets tests check which ranges were flushed; null otherwise.
+inline void (*msync_hook)(const std::filesystem::path&, std::size_t, std::size_t) = nullptr;
+
+// Shared read/write mapping of a whole file. The file is created and preallocated to `bytes`
+// if it does not exist yet, so stores into the mapping can never hit a hole (SIGBUS on ENOSPC).
+class mapped_file {
+public:
+    mapped_file() = default;
+
+    mapped_file(const std::filesystem::path& path, std::size_t bytes, bool* created = nullptr)
+        : path_(path) {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+            throw_errno("open " + path.string());
+
+        struct stat st {};
+        if (::fstat(fd_, &st) != 0)
+            fail("fstat " + path.string());
+        if (created != nullptr)
+            *created = st.st_size == 0;
+        if (static_cast<std::size_t>(st.st_size) < bytes) {
+            if (int rc = ::posix_fallocate(fd_, 0, static_cast<off_t>(bytes)); rc != 0) {
+                errno = rc;
+                fail("fallocate " + path.string());
+            }
+        }
+
+        map(bytes, PROT_READ | PROT_WRITE);
+    }
+
+    // Read-only mapping of the first `bytes` of a file that must already exist and be at least
+    // that long; unlike the constructor it never creates or extends anything.
+    [[nodiscard]] static mapped_file open_existing(const std::filesystem::path& path,
+                                                   std::size_t                  bytes) {
+        mapped_file file;
+        file.path_ = path;
+        file.fd_   = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file.fd_ < 0)
+            throw_errno("open " + path.string());
+
+        struct stat st {};
+        if (::fstat(file.fd_, &st) != 0)
+            file.fail("fstat " + path.string());
+        if (static_cast<std::size_t>(st.st_size) < bytes) {
+            errno = EINVAL;
+            file.fail("short file " + path.string());
+        }
+        file.map(bytes, PROT_READ);
+        return file;
+    }
+
+    mapped_file(const mapped_file&)            = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    mapped_file(mapped_file&& other) noexcept
+        : path_(std::move(other.path_))
+        , fd_(std::exchange(other.fd_, -1))
+        , data_(std::exchange(other.data_, nullptr))
+        , bytes_(std::exchange(other.bytes_, 0)) {}
+
+    mapped_file& operator=(mapped_file&& other) noexcept {
+        if (this != &other) {
+            close();
+            path_  = std::move(other.path_);
+            fd_    = std::exchange(other.fd_, -1);
+            data_  = std::exchange(other.data_, nullptr);
+            bytes_ = std::exchange(other.bytes_, 0);
+        }
+        return *this;
+    }
+
+    ~mapped_file() { close(); }
+
+    // Writes back [offset, offset + len) and waits for the device.
+    void sync(std::size_t offset, std::size_t len) {
+        if (msync_hook != nullptr) [[unlikely]]
+            msync_hook(path_, offset, len);
+        auto begin = offset & ~(page_size() - 1);
+        if (::msync(data_ + begin, offset + len - begin, MS_SYNC) != 0)
+            throw_errno("msync " + path_.string());
+    }
+
+    [[nodiscard]] std::byte* data() const noexcept { return data_; }
+    [[nodiscard]] std::size_t size() const noexcept { return bytes_; }
+    [[nodiscard]] explicit operator bool() const noexcept { return data_ != nullptr; }
+
+private:
+    void map(std::size_t bytes, int prot) {
+        void* p = ::mmap(nullptr, bytes, prot, MAP_SHARED | MAP_POPULATE, fd_, 0);
+        if (p == MAP_FAILED)
+            fail("mmap " + path_.string());
+        data_  = static_cast<std::byte*>(p);
+        bytes_ = bytes;
+    }
+
+    [[noreturn]] void fail(const std::string& what) {
+        int err = errno;
+        ::close(fd_);
+        fd_   = -1;
+        errno = err;
+        throw_errno(what);
+    }
+
+    void close() noexcept {
+        if (data_ != nullptr)
+            ::munmap(data_, bytes_);
+        if (fd_ >= 0)
+            ::close(fd_);
+        data_  = nullptr;
+        bytes_ = 0;
+        fd_    = -1;
+    }
+
+    std::filesystem::path path_;
+    int                   fd_{-1};
+    std::byte*            data_{nullptr};
+    std::size_t           bytes_{0};
+};
+
+// Makes newly created directory entries durable.
+inline void sync_directory(const std::filesystem::path& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        throw_errno("open " + dir.string());
+    int rc = ::fsync(fd);
+    int err = errno;
+    ::close(fd);
+    if (rc != 0) {
+        errno = err;
+        throw_errno("fsync " + dir.string());
+    }
+}
+
+}  // namespace nsqueue::details
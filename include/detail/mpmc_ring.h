@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "detail/cache_utils.h"
+
+namespace nsqueue::details {
+
+// Bounded multi-producer/multi-consumer ring (Vyukov). Each cell carries a sequence number
+// that tells producers and consumers whether it is free for the current lap, so the only
+// contended words are the two claim counters.
+template <typename T, std::size_t N>
+class mpmc_ring {
+    static_assert((N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+    using index_t = std::size_t;
+
+    mpmc_ring()
+        : cells_(std::make_unique<Cell[]>(N)) {
+        for (index_t i{0}; i < N; ++i)
+            cells_[i].seq_.store(i, std::memory_order_relaxed);
+    }
+
+    mpmc_ring(const mpmc_ring&)            = delete;
+    mpmc_ring& operator=(const mpmc_ring&) = delete;
+
+    [[nodiscard]] bool push(T item) noexcept {
+        auto pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& cell = cells_[pos & mask_];
+            auto  seq  = cell.seq_.load(std::memory_order_acquire);
+            auto  diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.data_ = std::move(item);
+                    cell.seq_.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    [[nodiscard]] bool pop(T& item) noexcept {
+        auto pos = dequeuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& cell = cells_[pos & mask_];
+            auto  seq  = cell.seq_.load(std::memory_order_acquire);
+            auto  diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    item = std::move(cell.data_);
+                    cell.seq_.store(pos + N, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return enqueuePos_.load(std::memory_order_acquire)
+            == dequeuePos_.load(std::memory_order_acquire);
+    }
+
+private:
+    struct Cell {
+        std::atomic<index_t> seq_{0};
+        T                    data_{};
+    };
+    static constexpr index_t mask_{N - 1};
+
+    std::unique_ptr<Cell[]>                     cells_;
+    alignas(falseSharingSize) std::atomic<index_t> enqueuePos_{0};
+    alignas(falseSharingSize) std::atomic<index_t> dequeuePos_{0};
+};
+
+}  // namespace nsqueue::details
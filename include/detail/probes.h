@@ -0,0 +1,18 @@
+#pragma once
+
+// USDT (SystemTap/DTrace-style) static probes on queue slow paths. Define NSQUEUE_ENABLE_USDT
+// to compile them in; each probe is then a single nop plus an ELF note that bpftrace, perf or
+// SystemTap can attach to at run time. Without it NSQ_PROBE expands to nothing.
+//
+//   NSQ_PROBE(name, queue, args...)   provider "nsqueue", first argument the queue's address
+
+#if defined(NSQUEUE_ENABLE_USDT) && NSQUEUE_ENABLE_USDT
+#if defined(__has_include) && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define NSQ_PROBE(name, ...) STAP_PROBEV(nsqueue, name, __VA_ARGS__)
+#else
+#error "NSQUEUE_ENABLE_USDT requires <sys/sdt.h> (systemtap-sdt-dev / systemtap-sdt-devel)"
+#endif
+#else
+#define NSQ_PROBE(name, ...) ((void)0)
+#endif
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "detail/mapped_file.h"
+
+namespace nsqueue::details {
+
+// Mapping of a POSIX shared-memory object. create() replaces any object left behind under the
+// same name and unlinks it again on destruction; open() maps an existing object read-only.
+class shared_memory {
+public:
+    shared_memory() = default;
+
+    [[nodiscard]] static shared_memory create(const std::string& name, std::size_t bytes) {
+        ::shm_unlink(name.c_str());
+        int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd < 0)
+            throw_errno("shm_open " + name);
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            int err = errno;
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            errno = err;
+            throw_errno("ftruncate " + name);
+        }
+        try {
+            shared_memory shm = map(fd, name, bytes, PROT_READ | PROT_WRITE);
+            shm.owner_        = true;
+            return shm;
+        } catch (...) {
+            ::shm_unlink(name.c_str());
+            throw;
+        }
+    }
+
+    [[nodiscard]] static shared_memory open(const std::string& name) {
+        int fd = ::shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+        if (fd < 0)
+            throw_errno("shm_open " + name);
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            int err = errno;
+            ::close(fd);
+            errno = err;
+            throw_errno("fstat " + name);
+        }
+        return map(fd, name, static_cast<std::size_t>(st.st_size), PROT_READ);
+    }
+
+    shared_memory(const shared_memory&)            = delete;
+    shared_memory& operator=(const shared_memory&) = delete;
+
+    shared_memory(shared_memory&& other) noexcept
+        : name_(std::move(other.name_))
+        , data_(std::exchange(other.data_, nullptr))
+        , bytes_(std::exchange(other.bytes_, 0))
+        , owner_(std::exchange(other.owner_, false)) {}
+
+    shared_memory& operator=(shared_memory&& other) noexcept {
+        if (this != &other) {
+            close();
+            name_  = std::move(other.name_);
+            data_  = std::exchange(other.data_, nullptr);
+            bytes_ = std::exchange(other.bytes_, 0);
+            owner_ = std::exchange(other.owner_, false);
+        }
+        return *this;
+    }
+
+    ~shared_memory() { close(); }
+
+    [[nodiscard]] std::byte* data() const noexcept { return data_; }
+    [[nodiscard]] std::size_t size() const noexcept { return bytes_; }
+    [[nodiscard]] std::string const& name() const noexcept { return name_; }
+    [[nodiscard]] explicit operator bool() const noexcept { return data_ != nullptr; }
+
+private:
+    static shared_memory map(int fd, const std::string& name, std::size_t bytes, int prot) {
+        void* p = bytes == 0 ? MAP_FAILED : ::mmap(nullptr, bytes, prot, MAP_SHARED, fd, 0);
+        int   err = errno;
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            errno = bytes == 0 ? EINVAL : err;
+            throw_errno("mmap " + name);
+        }
+        shared_memory shm;
+        shm.name_  = name;
+        shm.data_  = static_cast<std::byte*>(p);
+        shm.bytes_ = bytes;
+        return shm;
+    }
+
+    void close() noexcept {
+        if (data_ != nullptr)
+            ::munmap(data_, bytes_);
+        if (owner_)
+            ::shm_unlink(name_.c_str());
+        data_  = nullptr;
+        bytes_ = 0;
+        owner_ = false;
+    }
+
+    std::string name_;
+    std::byte*  data_{nullptr};
+    std::size_t bytes_{0};
+    bool        owner_{false};
+};
+
+// Names of the shared-memory objects that start with `prefix` followed by a dot. Relies on
+// Linux exposing them as files under /dev/shm; returns nothing where it does not.
+inline std::vector<std::string> list_shared_memory(const std::string& prefix) {
+    std::vector<std::string> names;
+    const auto               stem = (prefix.starts_with('/') ? prefix.substr(1) : prefix) + ".";
+    std::error_code          ec;
+    for (std::filesystem::directory_iterator it("/dev/shm", ec), end; !ec && it != end;
+         it.increment(ec)) {
+        auto file = it->path().filename().string();
+        if (file.starts_with(stem))
+            names.push_back("/" + file);
+    }
+    return names;
+}
+
+}  // namespace nsqueue::details
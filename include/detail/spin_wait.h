@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace nsqueue::details {
+
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Lets a thread park once spinning has failed without losing wakeups:
+//
+//   auto key = ec.prepare_wait();
+//   if (work_available()) ec.cancel_wait(); else ec.wait(key);
+//
+// Notifiers publish their work first and then call notify_*, which only touches the futex
+// when somebody has announced that they are about to sleep.
+class event_count {
+public:
+    [[nodiscard]] std::uint32_t prepare_wait() noexcept {
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        return epoch_.load(std::memory_order_seq_cst);
+    }
+
+    void cancel_wait() noexcept { waiters_.fetch_sub(1, std::memory_order_relaxed); }
+
+    void wait(std::uint32_t key) noexcept {
+        epoch_.wait(key, std::memory_order_acquire);
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void notify_one() noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_relaxed) != 0) [[unlikely]] {
+            epoch_.fetch_add(1, std::memory_order_release);
+            epoch_.notify_one();
+        }
+    }
+
+    void notify_all() noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_relaxed) != 0) [[unlikely]] {
+            epoch_.fetch_add(1, std::memory_order_release);
+            epoch_.notify_all();
+        }
+    }
+
+private:
+    std::atomic<std::uint32_t> epoch_{0};
+    std::atomic<std::uint32_t> waiters_{0};
+};
+
+}  // namespace nsqueue::details
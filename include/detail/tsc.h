@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+namespace nsqueue::details {
+
+// Cheapest monotonic tick source available: the TSC on x86 (invariant on anything recent),
+// the virtual counter on AArch64, steady_clock nanoseconds elsewhere. Ticks are only
+// comparable within one machine; convert with tsc_ns_per_tick().
+inline std::uint64_t tsc_now() noexcept {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t v;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch())
+                                          .count());
+#endif
+}
+
+// Like tsc_now(), but waits for all earlier instructions to finish before reading the counter
+// (rdtscp on x86), so the stamp is not taken ahead of the work it is meant to follow.
+inline std::uint64_t tscp_now() noexcept {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    unsigned aux;
+    return __rdtscp(&aux);
+#elif defined(__aarch64__)
+    std::uint64_t v;
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r"(v)::"memory");
+    return v;
+#else
+    return tsc_now();
+#endif
+}
+
+// Measured once per process. On x86 this spins for about 10 ms against steady_clock.
+inline double tsc_ns_per_tick() noexcept {
+    static const double ratio = [] {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        using clock     = std::chrono::steady_clock;
+        auto          t0 = clock::now();
+        std::uint64_t c0 = tsc_now();
+        while (clock::now() - t0 < std::chrono::milliseconds(10))
+            ;
+        auto          t1 = clock::now();
+        std::uint64_t c1 = tsc_now();
+        return std::chrono::duration<double, std::nano>(t1 - t0).count()
+             / static_cast<double>(c1 - c0);
+#elif defined(__aarch64__)
+        std::uint64_t freq;
+        asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+        return 1e9 / static_cast<double>(freq);
+#else
+        return 1.0;
+#endif
+    }();
+    return ratio;
+}
+
+}  // namespace nsqueue::details
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "detail/cache_utils.h"
+
+namespace nsqueue::details {
+
+// Bounded Chase-Lev deque (Le, Pop, Cohen, Zappa Nardelli, PPoPP'13). The owner pushes and pops
+// at the bottom, any other thread may steal from the top. Elements are read speculatively by
+// thieves before the CAS on top_, so T must be trivially copyable (in practice a pointer).
+template <typename T, std::size_t N>
+class work_stealing_deque {
+    static_assert((N & (N - 1)) == 0, "N must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+
+public:
+    using index_t = std::int64_t;
+
+    [[nodiscard]] bool push(T item) noexcept {
+        auto b = bottom_.load(std::memory_order_relaxed);
+        auto t = top_.load(std::memory_order_acquire);
+        if (b - t >= static_cast<index_t>(N)) [[unlikely]]
+            return false;
+
+        items_[b & mask_].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    [[nodiscard]] bool pop(T& item) noexcept {
+        auto b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = top_.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        item = items_[b & mask_].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last element: race against thieves for it.
+            bool won = top_.compare_exchange_strong(
+                t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool steal(T& item) noexcept {
+        auto t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto b = bottom_.load(std::memory_order_acquire);
+        if (t >= b)
+            return false;
+
+        item = items_[t & mask_].load(std::memory_order_relaxed);
+        return top_.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return bottom_.load(std::memory_order_acquire) <= top_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr index_t mask_{N - 1};
+
+    alignas(falseSharingSize) std::atomic<index_t> top_{0};
+    alignas(falseSharingSize) std::atomic<index_t> bottom_{0};
+    alignas(falseSharingSize) std::array<std::atomic<T>, N> items_{};
+};
+
+}  // namespace nsqueue::details
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "detail/tsc.h"
+#include "hardware_profile.h"
+#include "histogram.h"
+
+namespace nsqueue {
+
+// Sampling policies for spsc_queue. A policy provides a per-queue `state<N>` with
+//   stamp(slot), stamp(first, count)      producer, before publishing the slots
+//   measure(slot), measure(first, count)  consumer, after taking the slots
+// Ranges never wrap past slot N - 1.
+
+// Default: no metadata, and both hooks compile away.
+struct no_sampling {
+    template <std::size_t N>
+    struct state {
+        static void stamp(std::size_t, std::size_t = 1) noexcept {}
+        static void measure(std::size_t, std::size_t = 1) noexcept {}
+    };
+};
+
+// Measures how long items wait in the queue. Every slot whose index is a multiple of K gets a
+// TSC stamp in side metadata when it is filled. The consumer records the slot's dwell time in
+// nanoseconds into the queue's histogram when it takes the item out of the slot. Unsampled
+// slots cost one mask-and-compare of a slot index that is already in a register. The tick rate
+// is looked up when the queue is constructed, since calibrating it on first use would stall
+// the first sampled pop for about 10 ms.
+template <std::size_t K, typename Histogram = log_linear_histogram<>>
+struct dwell_sampling {
+    static_assert(K > 0 && (K & (K - 1)) == 0, "K must be a power of two");
+
+    template <std::size_t N>
+    struct state {
+        void stamp(std::size_t slot) noexcept {
+            if ((slot & (K - 1)) == 0) [[unlikely]]
+                stamps_[slot / K] = details::tsc_now();
+        }
+
+        void stamp(std::size_t first, std::size_t count) noexcept {
+            for (auto s = next_sampled(first); s < first + count; s += K)
+                stamps_[s / K] = details::tsc_now();
+        }
+
+        void measure(std::size_t slot) noexcept {
+            if ((slot & (K - 1)) == 0) [[unlikely]]
+                record(slot);
+        }
+
+        void measure(std::size_t first, std::size_t count) noexcept {
+            for (auto s = next_sampled(first); s < first + count; s += K)
+                record(s);
+        }
+
+        void record(std::size_t slot) noexcept {
+            auto now   = details::tsc_now();
+            auto stamp = stamps_[slot / K];
+            auto ticks = now > stamp ? now - stamp : 0;
+            histogram_.record(static_cast<std::uint64_t>(static_cast<double>(ticks) * nsPerTick_));
+        }
+
+        static constexpr std::size_t next_sampled(std::size_t slot) noexcept {
+            return (slot + K - 1) & ~(K - 1);
+        }
+
+        std::array<std::uint64_t, (N + K - 1) / K> stamps_{};
+        double                                     nsPerTick_{details::tsc_ns_per_tick()};
+        alignas(profiles::native::false_sharing) Histogram histogram_;
+    };
+};
+
+}  // namespace nsqueue
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "detail/cache_utils.h"
+#include "detail/tsc.h"
+
+namespace nsqueue {
+
+enum class queue_event_kind : std::uint8_t {
+    batch_begin,  // arg: requested items (0 if unbounded)
+    batch_end,    // arg: items transferred
+    full,         // a push found the ring full
+    empty,        // a pop found the ring empty
+    full_wait,    // force_push starts waiting for space
+    empty_wait,   // force_pop starts waiting for data
+    wakeup,       // the wait that started last has ended
+};
+
+struct queue_event {
+    std::uint64_t    ticks;  // details::tsc_now()
+    std::uint32_t    arg;
+    queue_event_kind kind;
+};
+
+// Fixed-size event log written by a single thread. record() never blocks or allocates: once
+// the log is full further events are counted as dropped. The length is published with a
+// release store, so size() and the events below it may be read while the owner is recording.
+class event_track {
+public:
+    event_track(std::string name, std::size_t capacity)
+        : name_(std::move(name))
+        , events_(std::make_unique<queue_event[]>(capacity))
+        , capacity_(capacity) {}
+
+    void record(queue_event_kind kind, std::uint32_t arg = 0) noexcept {
+        auto n = size_.load(std::memory_order_relaxed);
+        if (n == capacity_) [[unlikely]] {
+            dropped_.store(dropped_.load(std::memory_order_relaxed) + 1,
+                           std::memory_order_relaxed);
+            return;
+        }
+        events_[n] = {details::tsc_now(), arg, kind};
+        size_.store(n + 1, std::memory_order_release);
+    }
+
+    [[nodiscard]] std::string const& name() const noexcept { return name_; }
+    [[nodiscard]] std::size_t size() const noexcept { return size_.load(std::memory_order_acquire); }
+    [[nodiscard]] std::uint64_t dropped() const noexcept {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] queue_event const& operator[](std::size_t i) const noexcept { return events_[i]; }
+
+    // Forgets all events. Only the owning thread may call this.
+    void clear() noexcept {
+        size_.store(0, std::memory_order_relaxed);
+        dropped_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::string                    name_;
+    std::unique_ptr<queue_event[]> events_;
+    std::size_t                    capacity_;
+    alignas(details::falseSharingSize) std::atomic<std::size_t> size_{0};
+    std::atomic<std::uint64_t>     dropped_{0};
+};
+
+// Owns the tracks of any number of queues and threads. Creating a track takes a lock; recording
+// into one does not.
+class event_recorder {
+public:
+    explicit event_recorder(std::size_t events_per_track = 1 << 16)
+        : perTrack_(events_per_track)
+        , start_(details::tsc_now()) {}
+
+    event_recorder(const event_recorder&)            = delete;
+    event_recorder& operator=(const event_recorder&) = delete;
+
+    // The returned track stays valid for the recorder's lifetime.
+    [[nodiscard]] event_track& track(std::string name) {
+        std::lock_guard lock(mutex_);
+        tracks_.push_back(std::make_unique<event_track>(std::move(name), perTrack_));
+        return *tracks_.back();
+    }
+
+    // Writes every track in Chrome trace-event format, which chrome://tracing and
+    // ui.perfetto.dev open directly. Each track becomes a thread; batches and waits are slices,
+    // full and empty are instants. Throws std::runtime_error if the file cannot be written.
+    void write_chrome_trace(const std::filesystem::path& path) const {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out)
+            throw std::runtime_error("failed to open " + path.string());
+
+        const double nsPerTick = details::tsc_ns_per_tick();
+        char         buf[256];
+        bool         first{true};
+        auto emit = [&](std::string const& event) {
+            out << (first ? "\n" : ",\n") << event;
+            first = false;
+        };
+
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        std::lock_guard lock(mutex_);
+        for (std::size_t tid{0}; tid < tracks_.size(); ++tid) {
+            auto const& t = *tracks_[tid];
+            emit("{\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(tid)
+                 + ",\"name\":\"thread_name\",\"args\":{\"name\":\"" + escape(t.name()) + "\"}}");
+            if (t.dropped() != 0) {
+                std::snprintf(buf, sizeof(buf),
+                              "{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%zu,\"ts\":0,"
+                              "\"name\":\"dropped\",\"args\":{\"events\":%llu}}",
+                              tid, static_cast<unsigned long long>(t.dropped()));
+                emit(buf);
+            }
+
+            bool inSlice{false};  // batch_end and wakeup close only a slice that was opened
+            for (std::size_t i{0}, n = t.size(); i < n; ++i) {
+                auto const& e  = t[i];
+                double      us = e.ticks >= start_
+                                   ? static_cast<double>(e.ticks - start_) * nsPerTick / 1000.0
+                                   : 0.0;
+                auto slice = [&](char ph, const char* name, const char* argName) {
+                    int len = std::snprintf(buf, sizeof(buf),
+                                            "{\"ph\":\"%c\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,"
+                                            "\"name\":\"%s\"",
+                                            ph, tid, us, name);
+                    if (argName != nullptr)
+                        std::snprintf(buf + len, sizeof(buf) - len, ",\"args\":{\"%s\":%u}}",
+                                      argName, e.arg);
+                    else
+                        std::snprintf(buf + len, sizeof(buf) - len, "}");
+                    emit(buf);
+                };
+                switch (e.kind) {
+                case queue_event_kind::batch_begin:
+                    slice('B', "batch", "limit");
+                    inSlice = true;
+                    break;
+                case queue_event_kind::batch_end:
+                    if (inSlice)
+                        slice('E', "batch", "items");
+                    inSlice = false;
+                    break;
+                case queue_event_kind::full:
+                    slice('i', "full", nullptr);
+                    break;
+                case queue_event_kind::empty:
+                    slice('i', "empty", nullptr);
+                    break;
+                case queue_event_kind::full_wait:
+                    slice('B', "wait for space", nullptr);
+                    inSlice = true;
+                    break;
+                case queue_event_kind::empty_wait:
+                    slice('B', "wait for data", nullptr);
+                    inSlice = true;
+                    break;
+                case queue_event_kind::wakeup:
+                    if (inSlice)
+                        slice('E', "wakeup", nullptr);
+                    inSlice = false;
+                    break;
+                }
+            }
+        }
+        out << "\n]}\n";
+        if (!out)
+            throw std::runtime_error("failed to write " + path.string());
+    }
+
+private:
+    static std::string escape(std::string const& s) {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\')
+                out.push_back('\\');
+            if (static_cast<unsigned char>(c) >= 0x20)
+                out.push_back(c);
+        }
+        return out;
+    }
+
+    std::size_t                               perTrack_;
+    std::uint64_t                             start_;
+    mutable std::mutex                        mutex_;
+    std::vector<std::unique_ptr<event_track>> tracks_;
+};
+
+// Wraps a queue with the spsc_queue interface and records its stalls, waits and batches on a
+// producer track and a consumer track. Successful single pushes and pops are not recorded.
+template <typename Q>
+class traced_queue {
+public:
+    traced_queue(Q& queue, event_recorder& recorder, std::string const& name)
+        : queue_(queue)
+        , producer_(recorder.track(name + " producer"))
+        , consumer_(recorder.track(name + " consumer")) {}
+
+    template <typename T>
+    [[nodiscard]] bool push(T&& item) {
+        if (!queue_.push(std::forward<T>(item))) [[unlikely]] {
+            producer_.record(queue_event_kind::full);
+            return false;
+        }
+        return true;
+    }
+
+    template <typename T>
+    void force_push(T const& item) {
+        if (!queue_.push(item)) [[unlikely]] {
+            producer_.record(queue_event_kind::full_wait);
+            queue_.force_push(item);
+            producer_.record(queue_event_kind::wakeup);
+        }
+    }
+
+    template <typename T>
+    [[nodiscard]] bool pop(T& item) {
+        if (!queue_.pop(item)) [[unlikely]] {
+            consumer_.record(queue_event_kind::empty);
+            return false;
+        }
+        return true;
+    }
+
+    template <typename T>
+    void force_pop(T& item) {
+        if (!queue_.pop(item)) [[unlikely]] {
+            consumer_.record(queue_event_kind::empty_wait);
+            queue_.force_pop(item);
+            consumer_.record(queue_event_kind::wakeup);
+        }
+    }
+
+    template <typename F>
+    bool consume_one(F&& func) {
+        if (!queue_.consume_one(std::forward<F>(func))) [[unlikely]] {
+            consumer_.record(queue_event_kind::empty);
+            return false;
+        }
+        return true;
+    }
+
+    template <typename F>
+    std::size_t consume_all(F&& func) {
+        consumer_.record(queue_event_kind::batch_begin);
+        std::size_t n = queue_.consume_all(std::forward<F>(func));
+        consumer_.record(queue_event_kind::batch_end, static_cast<std::uint32_t>(n));
+        return n;
+    }
+
+    template <typename F>
+    std::size_t consume_n(F&& func, std::size_t n) {
+        consumer_.record(queue_event_kind::batch_begin, static_cast<std::uint32_t>(n));
+        std::size_t m = queue_.consume_n(std::forward<F>(func), n);
+        consumer_.record(queue_event_kind::batch_end, static_cast<std::uint32_t>(m));
+        return m;
+    }
+
+    template <typename T>
+    std::size_t push_bulk(T const* items, std::size_t n) {
+        producer_.record(queue_event_kind::batch_begin, static_cast<std::uint32_t>(n));
+        std::size_t m = queue_.push_bulk(items, n);
+        producer_.record(queue_event_kind::batch_end, static_cast<std::uint32_t>(m));
+        return m;
+    }
+
+    template <typename T>
+    std::size_t pop_bulk(T* items, std::size_t n) {
+        consumer_.record(queue_event_kind::batch_begin, static_cast<std::uint32_t>(n));
+        std::size_t m = queue_.pop_bulk(items, n);
+        consumer_.record(queue_event_kind::batch_end, static_cast<std::uint32_t>(m));
+        return m;
+    }
+
+    [[nodiscard]] Q& queue() noexcept { return queue_; }
+    [[nodiscard]] event_track& producer_track() noexcept { return producer_; }
+    [[nodiscard]] event_track& consumer_track() noexcept { return consumer_; }
+
+private:
+    Q&           queue_;
+    event_track& producer_;
+    event_track& consumer_;
+};
+
+}  // namespace nsqueue
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace nsqueue {
+
+// Compile-time description of the memory hierarchy that queue layouts are tuned for.
+//   LineSize      coherence granule
+//   FalseSharing  distance kept between producer-owned and consumer-owned state; larger than
+//                 the line where the hardware prefetches lines in pairs
+//   SlotAlignment alignment of each ring slot (1 means the element's natural alignment)
+//   SmtColocated  producer and consumer share a core's L1, so their state is packed together
+template <std::size_t LineSize, std::size_t FalseSharing, std::size_t SlotAlignment, bool SmtColocated>
+struct hardware_profile {
+    static_assert((LineSize & (LineSize - 1)) == 0, "LineSize must be a power of two");
+    static_assert((FalseSharing & (FalseSharing - 1)) == 0, "FalseSharing must be a power of two");
+    static_assert((SlotAlignment & (SlotAlignment - 1)) == 0, "SlotAlignment must be a power of two");
+
+    static constexpr std::size_t cache_line     = LineSize;
+    static constexpr std::size_t false_sharing  = FalseSharing;
+    static constexpr std::size_t slot_alignment = SlotAlignment;
+    static constexpr bool        smt_colocated  = SmtColocated;
+};
+
+namespace profiles {
+
+// Intel's adjacent-line prefetcher pulls in the buddy of every line it fetches, so two 64-byte
+// lines behave as one 128-byte unit for false sharing.
+using x86_64  = hardware_profile<64, 128, 128, false>;
+using aarch64 = hardware_profile<64, 64, 64, false>;
+using apple_m = hardware_profile<128, 128, 128, false>;
+using power   = hardware_profile<128, 128, 128, false>;
+using s390x   = hardware_profile<256, 256, 256, false>;
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+using native = x86_64;
+#elif defined(__aarch64__) && defined(__APPLE__)
+using native = apple_m;
+#elif defined(__aarch64__) || defined(_M_ARM64)
+using native = aarch64;
+#elif defined(__powerpc64__)
+using native = power;
+#elif defined(__s390x__)
+using native = s390x;
+#elif defined(__cpp_lib_hardware_interference_size)
+using native = hardware_profile<std::hardware_constructive_interference_size,
+                                std::hardware_destructive_interference_size,
+                                std::hardware_destructive_interference_size,
+                                false>;
+#else
+using native = hardware_profile<64, 64, 64, false>;
+#endif
+
+// For a producer and consumer pinned to hyperthreads of one core: nothing is gained by keeping
+// their cursors apart, and packing slots to their natural size halves the L1 footprint.
+template <typename Base = native>
+using smt_sibling = hardware_profile<Base::cache_line, Base::cache_line, 1, true>;
+
+}  // namespace profiles
+
+}  // namespace nsqueue
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nsqueue {
+
+// Counts of a log_linear_histogram copied out at one point in time.
+struct histogram_snapshot {
+    std::vector<std::uint64_t> counts;
+    std::vector<std::uint64_t> upper_bounds;  // largest value that lands in each bucket
+
+    [[nodiscard]] std::uint64_t total() const noexcept {
+        std::uint64_t n{0};
+        for (auto c : counts)
+            n += c;
+        return n;
+    }
+
+    // Upper bound of the bucket holding the q-th quantile (0 <= q <= 1), or 0 if empty.
+    [[nodiscard]] std::uint64_t percentile(double q) const noexcept {
+        auto n = total();
+        if (n == 0)
+            return 0;
+        auto rank = static_cast<std::uint64_t>(q * static_cast<double>(n - 1)) + 1;
+        std::uint64_t seen{0};
+        for (std::size_t i{0}; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= rank)
+                return upper_bounds[i];
+        }
+        return upper_bounds.back();
+    }
+
+    [[nodiscard]] std::uint64_t max() const noexcept {
+        for (std::size_t i = counts.size(); i-- > 0;)
+            if (counts[i] != 0)
+                return upper_bounds[i];
+        return 0;
+    }
+};
+
+// Fixed-size histogram with 2^SubBucketBits linear buckets per power of two, so every value is
+// recorded to within 1 / 2^SubBucketBits of its true size. Values from 2^MaxBits up land in
+// the last bucket. record() is meant for a single writer and uses relaxed stores rather than
+// read-modify-writes; snapshot() may be called from any thread.
+template <unsigned SubBucketBits = 4, unsigned MaxBits = 40>
+class log_linear_histogram {
+    static_assert(SubBucketBits > 0 && SubBucketBits < MaxBits && MaxBits < 64);
+
+public:
+    static constexpr std::size_t sub_buckets  = std::size_t{1} << SubBucketBits;
+    static constexpr std::size_t bucket_count = (MaxBits - SubBucketBits + 1) * sub_buckets;
+
+    static constexpr std::size_t bucket_index(std::uint64_t v) noexcept {
+        if (v < sub_buckets)
+            return static_cast<std::size_t>(v);
+        if (v >> MaxBits)
+            return bucket_count - 1;
+        unsigned shift = static_cast<unsigned>(std::bit_width(v)) - 1 - SubBucketBits;
+        return (shift + 1) * sub_buckets + static_cast<std::size_t>((v >> shift) - sub_buckets);
+    }
+
+    static constexpr std::uint64_t bucket_lower(std::size_t i) noexcept {
+        if (i < sub_buckets)
+            return i;
+        auto shift = i / sub_buckets - 1;
+        return (sub_buckets + i % sub_buckets) << shift;
+    }
+
+    static constexpr std::uint64_t bucket_upper(std::size_t i) noexcept {
+        if (i < sub_buckets)
+            return i;
+        return bucket_lower(i) + (std::uint64_t{1} << (i / sub_buckets - 1)) - 1;
+    }
+
+    void record(std::uint64_t v) noexcept {
+        auto& c = counts_[bucket_index(v)];
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Only the writer may reset.
+    void reset() noexcept {
+        for (auto& c : counts_)
+            c.store(0, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] histogram_snapshot snapshot() const {
+        histogram_snapshot s;
+        s.counts.resize(bucket_count);
+        s.upper_bounds.resize(bucket_count);
+        for (std::size_t i{0}; i < bucket_count; ++i) {
+            s.counts[i]       = counts_[i].load(std::memory_order_relaxed);
+            s.upper_bounds[i] = bucket_upper(i);
+        }
+        return s;
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, bucket_count> counts_{};
+};
+
+}  // namespace nsqueue
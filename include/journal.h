@@ -0,0 +1,304 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include "detail/cache_utils.h"
+#include "detail/mapped_file.h"
+
+namespace nsqueue {
+
+enum class durability {
+    none,          // page cache only: survives a process crash, not a power loss
+    batched,       // msync every `sync_every` appends and whenever a segment fills up
+    every_append,  // msync after every append
+};
+
+struct journal_options {
+    durability  policy     = durability::batched;
+    std::size_t sync_every = 1024;
+};
+
+// Persistent SPSC queue of trivially copyable records, backed by a directory of fixed-size
+// memory-mapped segment files plus a small meta file. It follows the spsc_queue index
+// discipline: the producer publishes its write index with a release store after copying the
+// record, the consumer keeps a cached copy and only reloads it when it runs dry. Both indices
+// live in the mapped meta file.
+//
+// durable_position() is the highest index known to have reached the device; after a power loss
+// only entries below it are guaranteed to be intact. The kernel may write the meta page back
+// before the segment pages it describes, so on reopen with a policy other than none the writer
+// and reader resume at durable_position() and anything appended after the last sync() is
+// overwritten. With durability::none they resume where the previous process left them, which
+// is only safe after a process crash.
+template <typename T, std::size_t SegmentEntries = (1 << 16)>
+class journal {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+    static_assert(SegmentEntries > 0, "SegmentEntries must be positive");
+
+public:
+    using index_t = std::uint64_t;
+
+    static constexpr std::size_t segment_bytes = SegmentEntries * sizeof(T);
+
+    explicit journal(std::filesystem::path dir, journal_options opts = {})
+        : dir_(std::move(dir))
+        , opts_(opts) {
+        std::filesystem::create_directories(dir_);
+
+        bool created{false};
+        metaFile_ = details::mapped_file(dir_ / "meta", details::page_size(), &created);
+        meta_     = reinterpret_cast<Meta*>(metaFile_.data());
+        if (created) {
+            meta_->magic_          = magic;
+            meta_->entryBytes_     = sizeof(T);
+            meta_->segmentEntries_ = SegmentEntries;
+            metaFile_.sync(0, sizeof(Meta));
+            details::sync_directory(dir_);
+        } else if (meta_->magic_ != magic || meta_->entryBytes_ != sizeof(T)
+                   || meta_->segmentEntries_ != SegmentEntries) {
+            throw std::runtime_error("journal layout mismatch in " + dir_.string());
+        }
+
+        if (opts_.policy != durability::none)
+            discard_unsynced();
+        writer_.writeIndex_      = meta_->writeIndex_.load(std::memory_order_acquire);
+        writer_.syncedIndex_     = writer_.writeIndex_;
+        reader_.readIndex_       = meta_->readIndex_.load(std::memory_order_acquire);
+        reader_.writeIndexCache_ = writer_.writeIndex_;
+    }
+
+    journal(const journal& other)            = delete;
+    journal& operator=(const journal& other) = delete;
+    journal(journal&& other)                 = delete;
+    journal& operator=(journal&& other)      = delete;
+
+    ~journal() {
+        if (opts_.policy != durability::none && writer_.segment_) {
+            try {
+                sync();
+            } catch (...) {
+            }
+        }
+    }
+
+    // Producer side.
+    void append(T const& item) {
+        auto pos = writer_.writeIndex_;
+        auto seg = pos / SegmentEntries;
+        if (seg != writer_.segmentIndex_ || !writer_.segment_) [[unlikely]]
+            map_writer(seg);
+
+        std::memcpy(writer_.segment_.data() + (pos % SegmentEntries) * sizeof(T), &item, sizeof(T));
+        writer_.writeIndex_ = pos + 1;
+        meta_->writeIndex_.store(pos + 1, std::memory_order_release);
+
+        if (opts_.policy == durability::every_append
+            || (opts_.policy == durability::batched
+                && pos + 1 - writer_.syncedIndex_ >= opts_.sync_every)) [[unlikely]]
+            sync();
+    }
+
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        append(T(std::forward<Args>(args)...));
+    }
+
+    // Producer side. Flushes every appended record and then the meta file.
+    void sync() {
+        auto pos = writer_.writeIndex_;
+        if (pos == writer_.syncedIndex_ || !writer_.segment_)
+            return;
+        // With durability::none the writer moves to a new segment without flushing the old one,
+        // so the records since the last sync may start several segments back.
+        for (auto seg = writer_.syncedIndex_ / SegmentEntries; seg < writer_.segmentIndex_; ++seg)
+            sync_earlier(seg);
+        auto segStart = writer_.segmentIndex_ * SegmentEntries;
+        auto from     = writer_.syncedIndex_ > segStart ? writer_.syncedIndex_ : segStart;
+        writer_.segment_.sync((from - segStart) * sizeof(T), (pos - from) * sizeof(T));
+
+        meta_->durableIndex_.store(pos, std::memory_order_relaxed);
+        metaFile_.sync(0, sizeof(Meta));
+        writer_.syncedIndex_ = pos;
+    }
+
+    // Consumer side.
+    [[nodiscard]] bool pop(T& item) {
+        auto pos = reader_.readIndex_;
+        if (pos == reader_.writeIndexCache_) [[unlikely]] {
+            reader_.writeIndexCache_ = meta_->writeIndex_.load(std::memory_order_acquire);
+            if (pos == reader_.writeIndexCache_) [[unlikely]]
+                return false;
+        }
+
+        auto seg = pos / SegmentEntries;
+        if (seg != reader_.segmentIndex_ || !reader_.segment_) [[unlikely]]
+            map_reader(seg);
+
+        std::memcpy(&item, reader_.segment_.data() + (pos % SegmentEntries) * sizeof(T), sizeof(T));
+        reader_.readIndex_ = pos + 1;
+        meta_->readIndex_.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <typename F>
+    bool consume_one(F&& func) {
+        T item;
+        if (!pop(item))
+            return false;
+        func(static_cast<T const&>(item));
+        return true;
+    }
+
+    template <typename F>
+    std::size_t consume_all(F&& func) {
+        std::size_t n{0};
+        while (consume_one(std::forward<F>(func)))
+            ++n;
+        return n;
+    }
+
+    // Consumer side. Moves the reader to a previously stored offset, e.g. one the application
+    // checkpointed alongside its own state.
+    void seek(index_t pos) {
+        auto w = meta_->writeIndex_.load(std::memory_order_acquire);
+        if (pos > w || pos < first_retained())
+            throw std::out_of_range("journal seek outside retained entries");
+        reader_.readIndex_       = pos;
+        reader_.writeIndexCache_ = w;
+        meta_->readIndex_.store(pos, std::memory_order_release);
+    }
+
+    // Consumer side. Deletes segment files that lie entirely below the read position. The new
+    // first segment reaches the device before any file goes, so a reopened journal never
+    // refers to a deleted segment.
+    void reclaim() {
+        auto first = reader_.readIndex_ / SegmentEntries;
+        auto old   = meta_->firstSegment_.load(std::memory_order_relaxed);
+        if (first <= old)
+            return;
+        meta_->firstSegment_.store(first, std::memory_order_release);
+        metaFile_.sync(0, sizeof(Meta));
+        for (auto seg = old; seg < first; ++seg)
+            std::filesystem::remove(segment_path(seg));
+    }
+
+    [[nodiscard]] index_t write_position() const noexcept {
+        return meta_->writeIndex_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] index_t read_position() const noexcept {
+        return meta_->readIndex_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] index_t durable_position() const noexcept {
+        return meta_->durableIndex_.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] index_t size() const noexcept { return write_position() - read_position(); }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    [[nodiscard]] const std::filesystem::path& directory() const noexcept { return dir_; }
+
+private:
+    static constexpr std::uint64_t magic = 0x324e524a5153534eULL;  // "NSSQJRN2"
+
+    struct Meta {
+        std::uint64_t                                   magic_;
+        std::uint64_t                                   entryBytes_;
+        std::uint64_t                                   segmentEntries_;
+        std::atomic<index_t>                            firstSegment_;
+        alignas(details::falseSharingSize) std::atomic<index_t> writeIndex_;
+        std::atomic<index_t>                            durableIndex_;
+        alignas(details::falseSharingSize) std::atomic<index_t> readIndex_;
+    };
+
+    std::filesystem::path segment_path(index_t seg) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.seg", static_cast<unsigned long long>(seg));
+        return dir_ / name;
+    }
+
+    index_t first_retained() const noexcept {
+        return meta_->firstSegment_.load(std::memory_order_acquire) * SegmentEntries;
+    }
+
+    // The stored write index may cover records that never reached the device, so only trust
+    // what the last sync() made durable. Readers past that point re-read from it, and segments
+    // that reclaim() dropped above it are recreated by the writer.
+    void discard_unsynced() {
+        auto durable = meta_->durableIndex_.load(std::memory_order_relaxed);
+        if (meta_->writeIndex_.load(std::memory_order_relaxed) <= durable)
+            return;
+        meta_->writeIndex_.store(durable, std::memory_order_relaxed);
+        if (meta_->readIndex_.load(std::memory_order_relaxed) > durable)
+            meta_->readIndex_.store(durable, std::memory_order_relaxed);
+        if (meta_->firstSegment_.load(std::memory_order_relaxed) > durable / SegmentEntries)
+            meta_->firstSegment_.store(durable / SegmentEntries, std::memory_order_relaxed);
+        metaFile_.sync(0, sizeof(Meta));
+    }
+
+    void map_writer(index_t seg) {
+        if (opts_.policy != durability::none)
+            sync();
+        bool created{false};
+        writer_.segment_      = details::mapped_file(segment_path(seg), segment_bytes, &created);
+        writer_.segmentIndex_ = seg;
+        if (created && opts_.policy != durability::none)
+            details::sync_directory(dir_);
+    }
+
+    // Flushes what the last sync() left unwritten of a segment the writer has moved past. The
+    // reader may have reclaimed it in the meantime, and then nothing in it needs to last.
+    void sync_earlier(index_t seg) {
+        auto segStart = seg * SegmentEntries;
+        auto from     = writer_.syncedIndex_ > segStart ? writer_.syncedIndex_ - segStart : 0;
+        if (seg < meta_->firstSegment_.load(std::memory_order_acquire))
+            return;
+        try {
+            auto file = details::mapped_file::open_existing(segment_path(seg), segment_bytes);
+            file.sync(from * sizeof(T), segment_bytes - from * sizeof(T));
+        } catch (std::system_error const& e) {
+            if (e.code() != std::errc::no_such_file_or_directory
+                || seg >= meta_->firstSegment_.load(std::memory_order_acquire))
+                throw;
+        }
+    }
+
+    // Segments are only ever created by the writer: a missing file means the range was removed,
+    // and reading it must fail rather than come back as zeroed records.
+    void map_reader(index_t seg) {
+        reader_.segment_ = details::mapped_file::open_existing(segment_path(seg), segment_bytes);
+        reader_.segmentIndex_ = seg;
+    }
+
+    std::filesystem::path dir_;
+    journal_options       opts_;
+    details::mapped_file  metaFile_;
+    Meta*                 meta_{nullptr};
+
+    struct alignas(details::falseSharingSize) ReadState {
+        index_t              readIndex_{0};
+        index_t              writeIndexCache_{0};
+        index_t              segmentIndex_{0};
+        details::mapped_file segment_;
+    } reader_;
+    struct alignas(details::falseSharingSize) WriteState {
+        index_t              writeIndex_{0};
+        index_t              syncedIndex_{0};
+        index_t              segmentIndex_{0};
+        details::mapped_file segment_;
+    } writer_;
+};
+
+}  // namespace nsqueue
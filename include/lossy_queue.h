@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "detail/cache_utils.h"
+
+namespace nsqueue {
+
+// Overwrite-oldest SPSC ring for telemetry and tracing. push() always succeeds and never reads
+// consumer state: when the ring is full it simply overwrites the oldest unread entry. Every slot
+// carries a sequence number (2 * position + 1 while being written, 2 * position + 2 once
+// complete), which lets the consumer detect both entries it has been lapped on and reads torn by
+// a concurrent overwrite. Lost entries are counted in dropped().
+template <typename T, std::size_t N>
+class lossy_queue {
+    static_assert((N & (N - 1)) == 0, "N must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+
+public:
+    using index_t = std::uint64_t;
+
+    lossy_queue()
+        : items_(std::make_unique<Slot[]>(N)) {}
+    lossy_queue(const lossy_queue& other)            = delete;
+    lossy_queue& operator=(const lossy_queue& other) = delete;
+    lossy_queue(lossy_queue&& other)                 = delete;
+    lossy_queue& operator=(lossy_queue&& other)      = delete;
+    ~lossy_queue()                                   = default;
+
+    void push(T const& item) noexcept {
+        auto  pos  = writer_.writeIndex_.load(std::memory_order_relaxed);
+        auto& slot = items_[pos & mask_];
+
+        slot.seq_.store(2 * pos + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&slot.obj_, &item, sizeof(T));
+        slot.seq_.store(2 * pos + 2, std::memory_order_release);
+
+        writer_.writeIndex_.store(pos + 1, std::memory_order_release);
+    }
+
+    template <typename... Args>
+    void emplace(Args&&... args) noexcept {
+        push(T(std::forward<Args>(args)...));
+    }
+
+    [[nodiscard]] bool pop(T& item) noexcept {
+        auto pos = reader_.readIndex_;
+        for (;;) {
+            auto& slot   = items_[pos & mask_];
+            auto  seq    = slot.seq_.load(std::memory_order_acquire);
+            auto  wanted = 2 * pos + 2;
+
+            if (seq < wanted) {
+                commit_drops(pos);
+                return false;
+            }
+            if (seq == wanted) {
+                std::memcpy(&item, &slot.obj_, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.seq_.load(std::memory_order_relaxed) == seq) [[likely]] {
+                    commit_drops(pos);
+                    reader_.readIndex_ = pos + 1;
+                    return true;
+                }
+            }
+            // Lapped, or overwritten while we were copying: skip to the oldest entry that can
+            // still be intact.
+            auto head = writer_.writeIndex_.load(std::memory_order_acquire);
+            pos       = std::max<index_t>(pos + 1, head > N ? head - N : 0);
+        }
+    }
+
+    template <typename F>
+    bool consume_one(F&& func) noexcept {
+        T item;
+        if (!pop(item))
+            return false;
+        func(static_cast<T const&>(item));
+        return true;
+    }
+
+    template <typename F>
+    std::size_t consume_all(F&& func) noexcept {
+        std::size_t n{0};
+        while (consume_one(std::forward<F>(func)))
+            ++n;
+        return n;
+    }
+
+    // Number of entries the consumer has skipped because they were overwritten.
+    [[nodiscard]] index_t dropped() const noexcept {
+        return reader_.dropped_.load(std::memory_order_relaxed);
+    }
+
+    // Consumer side only. Counts entries that are still in the ring, capped at N.
+    [[nodiscard]] index_t size() const noexcept {
+        auto w = writer_.writeIndex_.load(std::memory_order_acquire);
+        return std::min<index_t>(w - reader_.readIndex_, N);
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    [[nodiscard]] static constexpr index_t capacity() noexcept { return N; }
+
+private:
+    void commit_drops(index_t pos) noexcept {
+        if (pos != reader_.readIndex_) [[unlikely]] {
+            reader_.dropped_.store(reader_.dropped_.load(std::memory_order_relaxed)
+                                       + (pos - reader_.readIndex_),
+                                   std::memory_order_relaxed);
+            reader_.readIndex_ = pos;
+        }
+    }
+
+    struct alignas(details::falseSharingSize) Slot {
+        std::atomic<index_t> seq_{0};
+        T                    obj_{};
+    };
+    static constexpr index_t mask_{N - 1};
+
+    std::unique_ptr<Slot[]> items_;
+
+    struct alignas(details::falseSharingSize) ReadState {
+        index_t              readIndex_{0};
+        std::atomic<index_t> dropped_{0};
+    } reader_;
+    struct alignas(details::falseSharingSize) WriteState {
+        std::atomic<index_t> writeIndex_{0};
+    } writer_;
+};
+
+}  // namespace nsqueue
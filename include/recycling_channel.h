@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "spsc_queue.h"
+
+namespace nsqueue {
+
+// Fixed slab of N default-constructed objects with a LIFO free list. Not thread-safe: it is
+// meant to be owned by a single thread, which then always gets back the most recently released
+// (and therefore cache-warm) object first.
+template <typename T, std::size_t N>
+class object_pool {
+public:
+    using index_t = std::size_t;
+
+    object_pool()
+        : slab_(std::make_unique<T[]>(N)) {
+        for (index_t i{0}; i < N; ++i)
+            free_[i] = &slab_[N - 1 - i];
+    }
+    object_pool(const object_pool& other)            = delete;
+    object_pool& operator=(const object_pool& other) = delete;
+    object_pool(object_pool&& other)                 = delete;
+    object_pool& operator=(object_pool&& other)      = delete;
+    ~object_pool()                                   = default;
+
+    [[nodiscard]] T* acquire() noexcept { return top_ == 0 ? nullptr : free_[--top_]; }
+
+    void release(T* obj) noexcept { free_[top_++] = obj; }
+
+    [[nodiscard]] bool owns(T const* obj) const noexcept {
+        return std::greater_equal<T const*>{}(obj, slab_.get())
+            && std::less<T const*>{}(obj, slab_.get() + N);
+    }
+
+    [[nodiscard]] index_t available() const noexcept { return top_; }
+
+    [[nodiscard]] static constexpr index_t capacity() noexcept { return N; }
+
+private:
+    std::unique_ptr<T[]> slab_;
+    std::array<T*, N>    free_{};
+    index_t              top_{N};
+};
+
+// SPSC message channel that never allocates in steady state. The producer takes buffers from
+// an object_pool it owns and sends pointers over a forward ring; the consumer hands them back
+// over a return ring, which the producer drains into its pool only when the pool runs dry.
+// Both rings can hold every buffer, so send() and release() never wait.
+template <typename T, std::size_t N>
+class recycling_channel {
+    static constexpr std::size_t ring_size = std::bit_ceil(N);
+
+public:
+    using index_t = std::size_t;
+
+    recycling_channel()                                          = default;
+    recycling_channel(const recycling_channel& other)            = delete;
+    recycling_channel& operator=(const recycling_channel& other) = delete;
+    recycling_channel(recycling_channel&& other)                 = delete;
+    recycling_channel& operator=(recycling_channel&& other)      = delete;
+    ~recycling_channel()                                         = default;
+
+    // Producer side. Returns nullptr when all N buffers are in flight.
+    [[nodiscard]] T* acquire() noexcept {
+        if (auto* obj = pool_.acquire()) [[likely]]
+            return obj;
+        returned_.consume_all([this](T* obj) { pool_.release(obj); });
+        return pool_.acquire();
+    }
+
+    void send(T* obj) noexcept { forward_.force_push(obj); }
+
+    // Acquires a buffer, lets func fill it in place and sends it.
+    template <typename F>
+    [[nodiscard]] bool produce(F&& func) noexcept {
+        T* obj = acquire();
+        if (obj == nullptr)
+            return false;
+        func(*obj);
+        send(obj);
+        return true;
+    }
+
+    // Consumer side. The buffer stays valid until it is passed to release().
+    [[nodiscard]] T* receive() noexcept {
+        T* obj{nullptr};
+        return forward_.pop(obj) ? obj : nullptr;
+    }
+
+    void release(T* obj) noexcept { returned_.force_push(obj); }
+
+    template <typename F>
+    bool consume_one(F&& func) noexcept {
+        T* obj = receive();
+        if (obj == nullptr)
+            return false;
+        func(*obj);
+        release(obj);
+        return true;
+    }
+
+    template <typename F>
+    index_t consume_all(F&& func) noexcept {
+        index_t n{0};
+        while (consume_one(std::forward<F>(func)))
+            ++n;
+        return n;
+    }
+
+    [[nodiscard]] bool owns(T const* obj) const noexcept { return pool_.owns(obj); }
+
+    [[nodiscard]] index_t size() const noexcept { return forward_.size(); }
+
+    [[nodiscard]] bool empty() const noexcept { return forward_.empty(); }
+
+    [[nodiscard]] static constexpr index_t capacity() noexcept { return N; }
+
+private:
+    object_pool<T, N>          pool_;
+    spsc_queue<T*, ring_size>  forward_;
+    spsc_queue<T*, ring_size>  returned_;
+};
+
+}  // namespace nsqueue
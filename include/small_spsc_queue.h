@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "detail/atomic.h"
+#include "detail/cache_utils.h"
+
+namespace nsqueue {
+
+enum class queue_layout {
+    split,        // producer and consumer cursors kept falseSharingSize apart
+    shared_line,  // all cursors packed together, for endpoints on SMT siblings
+};
+
+namespace details {
+
+template <typename C, queue_layout Layout>
+struct small_cursors;
+
+template <typename C>
+struct small_cursors<C, queue_layout::split> {
+    struct alignas(falseSharingSize) ReadState {
+        details::atomic<C> readIndex_{0};
+        C                  writeIndexCache_{0};
+    } reader_;
+    struct alignas(falseSharingSize) WriteState {
+        details::atomic<C> writeIndex_{0};
+        C                  readIndexCache_{0};
+    } writer_;
+};
+
+template <typename C>
+struct small_cursors<C, queue_layout::shared_line> {
+    struct ReadState {
+        details::atomic<C> readIndex_{0};
+        C                  writeIndexCache_{0};
+    } reader_;
+    struct WriteState {
+        details::atomic<C> writeIndex_{0};
+        C                  readIndexCache_{0};
+    } writer_;
+};
+
+}  // namespace details
+
+// SPSC queue for large numbers of short queues such as actor mailboxes. Cursors are 16 bits wide
+// (32 for N above 32768) and run freely like spsc_queue's, slots are packed without padding,
+// and storage is always inline. With queue_layout::shared_line the whole control block takes
+// 4 * sizeof(cursor) bytes; that is only a win when producer and consumer share a core's cache.
+template <typename T, std::size_t N, queue_layout Layout = queue_layout::split>
+class small_spsc_queue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+    static_assert(N <= (std::size_t{1} << 31), "N must fit a 32-bit cursor");
+
+public:
+    using index_t  = std::size_t;
+    using cursor_t = std::conditional_t<(N <= (1u << 15)), std::uint16_t, std::uint32_t>;
+
+    small_spsc_queue()                                         = default;
+    small_spsc_queue(const small_spsc_queue& other)            = delete;
+    small_spsc_queue& operator=(const small_spsc_queue& other) = delete;
+    small_spsc_queue(small_spsc_queue&& other)                 = delete;
+    small_spsc_queue& operator=(small_spsc_queue&& other)      = delete;
+    ~small_spsc_queue()                                        = default;
+
+    template <typename... Args>
+    [[nodiscard]] bool emplace(Args&&... args) noexcept {
+        auto& w        = cursors_.writer_;
+        auto  writeIdx = w.writeIndex_.load(std::memory_order_relaxed);
+
+        if (distance(writeIdx, w.readIndexCache_) == N) [[unlikely]] {
+            w.readIndexCache_ = cursors_.reader_.readIndex_.load(std::memory_order_acquire);
+            if (distance(writeIdx, w.readIndexCache_) == N) [[unlikely]]
+                return false;
+        }
+
+        items_[writeIdx & mask_] = T(std::forward<Args>(args)...);
+        w.writeIndex_.store(static_cast<cursor_t>(writeIdx + 1), std::memory_order_release);
+
+        return true;
+    }
+
+    template <typename... Args>
+    void force_emplace(Args&&... args) noexcept {
+        auto& w        = cursors_.writer_;
+        auto  writeIdx = w.writeIndex_.load(std::memory_order_relaxed);
+
+        while (distance(writeIdx, w.readIndexCache_) == N) {
+            w.readIndexCache_ = cursors_.reader_.readIndex_.load(std::memory_order_acquire);
+        }
+
+        items_[writeIdx & mask_] = T(std::forward<Args>(args)...);
+        w.writeIndex_.store(static_cast<cursor_t>(writeIdx + 1), std::memory_order_release);
+    }
+
+    [[nodiscard]] bool push(T const& item) noexcept { return emplace(item); }
+
+    void force_push(T const& item) noexcept { force_emplace(item); }
+
+    [[nodiscard]] bool pop(T& item) noexcept {
+        return consume_one([&](T&& v) { item = std::move(v); });
+    }
+
+    void force_pop(T& item) noexcept {
+        auto& r       = cursors_.reader_;
+        auto  readIdx = r.readIndex_.load(std::memory_order_relaxed);
+
+        while (readIdx == r.writeIndexCache_) {
+            r.writeIndexCache_ = cursors_.writer_.writeIndex_.load(std::memory_order_acquire);
+        }
+
+        item = std::move(items_[readIdx & mask_]);
+        r.readIndex_.store(static_cast<cursor_t>(readIdx + 1), std::memory_order_release);
+    }
+
+    template <typename F>
+    bool consume_one(F&& func) noexcept {
+        auto& r       = cursors_.reader_;
+        auto  readIdx = r.readIndex_.load(std::memory_order_relaxed);
+
+        if (readIdx == r.writeIndexCache_) [[unlikely]] {
+            r.writeIndexCache_ = cursors_.writer_.writeIndex_.load(std::memory_order_acquire);
+            if (readIdx == r.writeIndexCache_) [[unlikely]]
+                return false;
+        }
+
+        func(std::move(items_[readIdx & mask_]));
+        r.readIndex_.store(static_cast<cursor_t>(readIdx + 1), std::memory_order_release);
+
+        return true;
+    }
+
+    template <typename F>
+    index_t consume_all(F&& func) noexcept {
+        index_t n{0};
+        while (consume_one(std::forward<F>(func)))
+            ++n;
+        return n;
+    }
+
+    [[nodiscard]] bool full() const noexcept { return size() == N; }
+
+    [[nodiscard]] index_t size() const noexcept {
+        auto r = cursors_.reader_.readIndex_.load(std::memory_order_acquire);
+        auto w = cursors_.writer_.writeIndex_.load(std::memory_order_acquire);
+        return distance(w, r);
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return size() == 0; }
+
+    [[nodiscard]] static constexpr index_t capacity() noexcept { return N; }
+
+private:
+    static constexpr cursor_t mask_ = static_cast<cursor_t>(N - 1);
+
+    // Cursor arithmetic has to wrap at the cursor width, not at int after promotion.
+    static constexpr index_t distance(cursor_t to, cursor_t from) noexcept {
+        return static_cast<cursor_t>(to - from);
+    }
+
+    details::small_cursors<cursor_t, Layout> cursors_;
+    T                                        items_[N]{};
+};
+
+}  // namespace nsqueue
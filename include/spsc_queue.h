@@ -1,69 +1,131 @@
+#pragma once
+
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <bitset>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
 
+#include "detail/atomic.h"
+#include "detail/cache_utils.h"
+#include "detail/copy_kernels.h"
+#include "detail/probes.h"
+#include "dwell_sampling.h"
+#include "hardware_profile.h"
+
 constexpr std::size_t STACK_BYTES = 524'288;
 
 namespace nsqueue {
 
 namespace details {
 
-#ifdef _cpp_lib_hardware_interference_size
-static constexpr std::size_t cacheLineSize = std::hardware_destructive_interference_size;
-#else
-static constexpr std::size_t cacheLineSize = 64;
-#endif
+struct no_allocator {};
+
+template <typename Allocator, typename U>
+struct rebind_alloc {
+    using type = typename std::allocator_traits<Allocator>::template rebind_alloc<U>;
+};
+template <typename U>
+struct rebind_alloc<void, U> {
+    using type = no_allocator;
+};
 
 }  // namespace details
 
-template <typename T, std::size_t N>
+// Slots live inline when the default allocator is used and they fit in STACK_BYTES; otherwise
+// they come from Allocator, or from a caller-owned buffer of required_bytes() bytes aligned to
+// required_alignment(). With Allocator = void a buffer is the only way to construct the queue.
+// Profile sets slot alignment and how far apart producer and consumer state are kept.
+// Sampling = dwell_sampling<K> measures how long every K-th slot's item waits in the queue.
+template <typename T,
+          std::size_t N,
+          typename Allocator = std::allocator<T>,
+          typename Profile   = profiles::native,
+          typename Sampling  = no_sampling>
 class spsc_queue {
-    static_assert((N & (N - 1)) == 0, "N must be a power of two");
-    static constexpr std::size_t storage_bytes = 2 * N * details::cacheLineSize;
-    static constexpr bool        use_heap      = storage_bytes > STACK_BYTES;
+    static_assert(N > 0, "N must be positive");
+
+    struct AlignedData {
+        alignas(std::max(alignof(T), Profile::slot_alignment)) T mObj{};
+    };
+    using slot_allocator = typename details::rebind_alloc<Allocator, AlignedData>::type;
+    using alloc_arg
+        = std::conditional_t<std::is_void_v<Allocator>, details::no_allocator, Allocator>;
+
+    static constexpr bool inline_storage
+        = std::is_same_v<Allocator, std::allocator<T>> && N * sizeof(AlignedData) <= STACK_BYTES;
 
 public:
-    using index_t = std::size_t;
+    using index_t        = std::size_t;
+    using allocator_type = Allocator;
+    using profile_type   = Profile;
+    using sampling_type  = Sampling;
+
+    spsc_queue() requires(!std::is_void_v<Allocator>) = default;
+
+    explicit spsc_queue(alloc_arg const& alloc)
+        requires(!inline_storage && !std::is_void_v<Allocator>)
+        : items_(slot_allocator(alloc)) {}
+
+    // Places the slots in [buffer, buffer + bytes), which must outlive the queue. Throws
+    // std::invalid_argument if the buffer is too small or misaligned.
+    spsc_queue(void* buffer, std::size_t bytes) requires(!inline_storage)
+        : items_(checked_buffer(buffer, bytes)) {}
 
-    spsc_queue()                                   = default;
     spsc_queue(const spsc_queue& other)            = delete;
     spsc_queue& operator=(const spsc_queue& other) = delete;
     spsc_queue(spsc_queue&& other)                 = delete;
     spsc_queue& operator=(spsc_queue&& other)      = delete;
     ~spsc_queue()                                  = default;
 
+    [[nodiscard]] static constexpr std::size_t required_bytes() noexcept {
+        return N * sizeof(AlignedData);
+    }
+
+    [[nodiscard]] static constexpr std::size_t required_alignment() noexcept {
+        return alignof(AlignedData);
+    }
+
     template <typename... Args>
     [[nodiscard]] bool emplace(Args&&... args) noexcept {
-        auto writeIdx     = writer_.writeIndex_.load(std::memory_order_relaxed);
-        auto nextWriteIdx = (writeIdx + 1) & mask_;
+        auto writeIdx = writer_.writeIndex_.load(std::memory_order_relaxed);
 
-        if (nextWriteIdx == writer_.readIndexCache_) [[unlikely]] {
+        if (distance(writeIdx, writer_.readIndexCache_) == N) [[unlikely]] {
             writer_.readIndexCache_ = reader_.readIndex_.load(std::memory_order_acquire);
-            if (nextWriteIdx == writer_.readIndexCache_) [[unlikely]]
+            NSQ_PROBE(push_refresh, this, writeIdx, writer_.readIndexCache_);
+            if (distance(writeIdx, writer_.readIndexCache_) == N) [[unlikely]] {
+                NSQ_PROBE(push_full, this, writeIdx);
                 return false;
+            }
         }
 
-        new (&items_[writeIdx].mObj) T(std::forward<Args>(args)...);
-        writer_.writeIndex_.store(nextWriteIdx, std::memory_order_relaxed);
+        new (&items_[slot(writeIdx)].mObj) T(std::forward<Args>(args)...);
+        sampling_.stamp(slot(writeIdx));
+        writer_.writeIndex_.store(advance(writeIdx, 1), std::memory_order_release);
 
         return true;
     }
 
     template <typename... Args>
     void force_emplace(Args&&... args) noexcept {
-        auto writeIdx     = writer_.writeIndex_.load(std::memory_order_relaxed);
-        auto nextWriteIdx = (writeIdx + 1) & mask_;
-
-        while (nextWriteIdx == writer_.readIndexCache_) {
-            writer_.readIndexCache_ = reader_.readIndex_.load(std::memory_order_acquire);
+        auto writeIdx = writer_.writeIndex_.load(std::memory_order_relaxed);
+
+        if (distance(writeIdx, writer_.readIndexCache_) == N) [[unlikely]] {
+            NSQ_PROBE(force_push_wait_begin, this, writeIdx);
+            do {
+                writer_.readIndexCache_ = reader_.readIndex_.load(std::memory_order_acquire);
+            } while (distance(writeIdx, writer_.readIndexCache_) == N);
+            NSQ_PROBE(force_push_wait_end, this, writeIdx);
         }
 
-        new (&items_[writeIdx].mObj) T(std::forward<Args>(args)...);
-        writer_.writeIndex_.store(nextWriteIdx, std::memory_order_relaxed);
+        new (&items_[slot(writeIdx)].mObj) T(std::forward<Args>(args)...);
+        sampling_.stamp(slot(writeIdx));
+        writer_.writeIndex_.store(advance(writeIdx, 1), std::memory_order_release);
     }
 
     [[nodiscard]] bool push(T const& item) noexcept { return emplace(item); }
@@ -73,27 +135,35 @@ public:
     void force_pop(T& item) noexcept {
         auto readIdx  = reader_.readIndex_.load(std::memory_order_relaxed);
         auto writeIdx = reader_.writeIndexCache_;
-        while (readIdx == writeIdx) {
-            writeIdx = reader_.writeIndexCache_
-                = writer_.writeIndex_.load(std::memory_order_acquire);
+        if (readIdx == writeIdx) [[unlikely]] {
+            NSQ_PROBE(force_pop_wait_begin, this, readIdx);
+            do {
+                writeIdx = reader_.writeIndexCache_
+                    = writer_.writeIndex_.load(std::memory_order_acquire);
+            } while (readIdx == writeIdx);
+            NSQ_PROBE(force_pop_wait_end, this, readIdx);
         }
 
-        item = std::move(items_[readIdx].mObj);
+        item = std::move(items_[slot(readIdx)].mObj);
+        sampling_.measure(slot(readIdx));
 
-        auto nextReadIdx = (readIdx + 1) & mask_;
-        reader_.readIndex_.store(nextReadIdx, std::memory_order_relaxed);
+        reader_.readIndex_.store(advance(readIdx, 1), std::memory_order_release);
     }
 
     void force_pop() noexcept {
         auto readIdx  = reader_.readIndex_.load(std::memory_order_relaxed);
         auto writeIdx = reader_.writeIndexCache_;
-        while (readIdx == writeIdx) {
-            writeIdx = reader_.writeIndexCache_
-                = writer_.writeIndex_.load(std::memory_order_acquire);
+        if (readIdx == writeIdx) [[unlikely]] {
+            NSQ_PROBE(force_pop_wait_begin, this, readIdx);
+            do {
+                writeIdx = reader_.writeIndexCache_
+                    = writer_.writeIndex_.load(std::memory_order_acquire);
+            } while (readIdx == writeIdx);
+            NSQ_PROBE(force_pop_wait_end, this, readIdx);
         }
 
-        auto nextReadIdx = (readIdx + 1) & mask_;
-        reader_.readIndex_.store(nextReadIdx, std::memory_order_relaxed);
+        sampling_.measure(slot(readIdx));
+        reader_.readIndex_.store(advance(readIdx, 1), std::memory_order_release);
     }
 
     [[nodiscard]] bool pop(T& item) noexcept {
@@ -102,14 +172,17 @@ public:
         if (readIdx == writeIdx) [[unlikely]] {
             writeIdx = reader_.writeIndexCache_
                 = writer_.writeIndex_.load(std::memory_order_acquire);
-            if (readIdx == writeIdx) [[unlikely]]
+            NSQ_PROBE(pop_refresh, this, readIdx, writeIdx);
+            if (readIdx == writeIdx) [[unlikely]] {
+                NSQ_PROBE(pop_empty, this, readIdx);
                 return false;
+            }
         }
 
-        item = std::move(items_[readIdx].mObj);
+        item = std::move(items_[slot(readIdx)].mObj);
+        sampling_.measure(slot(readIdx));
 
-        auto nextReadIdx = (readIdx + 1) & mask_;
-        reader_.readIndex_.store(nextReadIdx, std::memory_order_relaxed);
+        reader_.readIndex_.store(advance(readIdx, 1), std::memory_order_release);
 
         return true;
     }
@@ -120,64 +193,123 @@ public:
         if (readIdx == writeIdx) [[unlikely]] {
             writeIdx = reader_.writeIndexCache_
                 = writer_.writeIndex_.load(std::memory_order_acquire);
-            if (readIdx == writeIdx) [[unlikely]]
+            NSQ_PROBE(pop_refresh, this, readIdx, writeIdx);
+            if (readIdx == writeIdx) [[unlikely]] {
+                NSQ_PROBE(pop_empty, this, readIdx);
                 return false;
+            }
         }
 
-        auto nextReadIdx = (readIdx + 1) & mask_;
-        reader_.readIndex_.store(nextReadIdx, std::memory_order_relaxed);
+        sampling_.measure(slot(readIdx));
+        reader_.readIndex_.store(advance(readIdx, 1), std::memory_order_release);
 
         return true;
     }
 
     template <typename F>
     bool consume_one(F&& func) noexcept {
-        auto readIdx  = reader_.readIndex_.load(std::memory_order_relaxed);
-        auto writeIdx = reader_.writeIndexCache_;
-        if (readIdx == writeIdx) [[unlikely]] {
-            writeIdx = reader_.writeIndexCache_
-                = writer_.writeIndex_.load(std::memory_order_acquire);
-            if (readIdx == writeIdx) [[unlikely]]
-                return false;
-        }
-
-        func(std::move(items_[readIdx].mObj));
-
-        auto nextReadIdx = (readIdx + 1) & mask_;
-        reader_.readIndex_.store(nextReadIdx, std::memory_order_release);
-
-        return true;
+        return consume(std::forward<F>(func), true);
     }
 
+    // Running dry after at least one item only ends the batch, so pop_empty fires only when a
+    // batch finds nothing at all.
     template <typename F>
     index_t consume_all(F&& func) noexcept {
+        NSQ_PROBE(consume_batch_begin, this, N);
         index_t n{0};
-        while (consume_one(std::forward<F>(func)))
+        while (consume(std::forward<F>(func), n == 0))
             ++n;
+        NSQ_PROBE(consume_batch_end, this, n);
         return n;
     }
 
     template <typename F>
     index_t consume_n(F&& func, index_t n) noexcept {
+        NSQ_PROBE(consume_batch_begin, this, n);
         index_t m{};
         for (; m < n; ++m) {
-            if (!consume_one(std::forward<F>(func)))
+            if (!consume(std::forward<F>(func), m == 0))
                 break;
         }
+        NSQ_PROBE(consume_batch_end, this, m);
         return m;
     }
 
+    // Copies up to n items in, publishing them with a single index update. Returns the number
+    // of items enqueued.
+    index_t push_bulk(T const* items, index_t n, store_hint hint = store_hint::automatic) noexcept
+        requires std::is_trivially_copyable_v<T>
+    {
+        auto writeIdx = writer_.writeIndex_.load(std::memory_order_relaxed);
+        auto space    = N - distance(writeIdx, writer_.readIndexCache_);
+        if (space < n) {
+            writer_.readIndexCache_ = reader_.readIndex_.load(std::memory_order_acquire);
+            space                   = N - distance(writeIdx, writer_.readIndexCache_);
+            NSQ_PROBE(push_refresh, this, writeIdx, writer_.readIndexCache_);
+        }
+        n = std::min(n, space);
+        if (n == 0)
+            return 0;
+
+        const bool stream = hint == store_hint::streaming
+                         || (hint == store_hint::automatic
+                             && n * sizeof(T) >= NSQUEUE_STREAMING_THRESHOLD);
+        const auto copy  = details::copy_records();
+        const auto start = slot(writeIdx);
+        const auto first = std::min<index_t>(n, N - start);
+        copy(slot_bytes(start), sizeof(AlignedData), as_bytes(items), sizeof(T), sizeof(T),
+             first, stream);
+        copy(slot_bytes(0), sizeof(AlignedData), as_bytes(items + first), sizeof(T), sizeof(T),
+             n - first, stream);
+        sampling_.stamp(start, first);
+        sampling_.stamp(0, n - first);
+        if (stream)
+            details::store_fence();
+
+        writer_.writeIndex_.store(advance(writeIdx, n), std::memory_order_release);
+        return n;
+    }
+
+    // Copies up to n items out, releasing their slots with a single index update. Returns the
+    // number of items dequeued.
+    index_t pop_bulk(T* items, index_t n) noexcept
+        requires std::is_trivially_copyable_v<T>
+    {
+        auto readIdx   = reader_.readIndex_.load(std::memory_order_relaxed);
+        auto available = distance(reader_.writeIndexCache_, readIdx);
+        if (available < n) {
+            reader_.writeIndexCache_ = writer_.writeIndex_.load(std::memory_order_acquire);
+            available                = distance(reader_.writeIndexCache_, readIdx);
+            NSQ_PROBE(pop_refresh, this, readIdx, reader_.writeIndexCache_);
+        }
+        n = std::min(n, available);
+        if (n == 0)
+            return 0;
+
+        const auto copy  = details::copy_records();
+        const auto start = slot(readIdx);
+        const auto first = std::min<index_t>(n, N - start);
+        copy(as_bytes(items), sizeof(T), slot_bytes(start), sizeof(AlignedData), sizeof(T),
+             first, false);
+        copy(as_bytes(items + first), sizeof(T), slot_bytes(0), sizeof(AlignedData), sizeof(T),
+             n - first, false);
+        sampling_.measure(start, first);
+        sampling_.measure(0, n - first);
+
+        reader_.readIndex_.store(advance(readIdx, n), std::memory_order_release);
+        return n;
+    }
+
     [[nodiscard]] bool full() const noexcept {
-        auto writeIdx     = writer_.writeIndex_.load(std::memory_order_acquire);
-        auto nextWriteIdx = (writeIdx + 1) & mask_;
-        auto readIdx      = reader_.readIndex_.load(std::memory_order_acquire);
-        return nextWriteIdx == readIdx;
+        auto r = reader_.readIndex_.load(std::memory_order_acquire);
+        auto w = writer_.writeIndex_.load(std::memory_order_acquire);
+        return distance(w, r) == N;
     }
 
     [[nodiscard]] index_t size() const noexcept {
-        auto w = writer_.writeIndex_.load(std::memory_order_acquire);
         auto r = reader_.readIndex_.load(std::memory_order_acquire);
-        return (w >= r) ? w - r : (N - r) + w;
+        auto w = writer_.writeIndex_.load(std::memory_order_acquire);
+        return distance(w, r);
     }
 
     [[nodiscard]] bool empty() const noexcept {
@@ -188,16 +320,23 @@ public:
     [[nodiscard]] index_t read_available() const noexcept { return size(); }
 
     [[nodiscard]] T& front() noexcept {
-        const auto r = reader_.readIdx_.load(std::memory_order_acquire);
-        return items_[r].mObj;
+        const auto r = reader_.readIndex_.load(std::memory_order_relaxed);
+        return items_[slot(r)].mObj;
     }
 
     [[nodiscard]] T const& front() const noexcept {
-        const auto r = reader_.readIdx_.load(std::memory_order_acquire);
-        return items_[r].mObj;
+        const auto r = reader_.readIndex_.load(std::memory_order_relaxed);
+        return items_[slot(r)].mObj;
     }
 
-    [[nodiscard]] size_t capacity() const noexcept { return mask_; }
+    [[nodiscard]] size_t capacity() const noexcept { return N; }
+
+    // Dwell times in nanoseconds of the sampled items popped so far. Safe to read from any thread.
+    [[nodiscard]] auto const& dwell_histogram() const noexcept
+        requires(!std::is_same_v<Sampling, no_sampling>)
+    {
+        return sampling_.histogram_;
+    }
 
     void reset(void) noexcept {
         writer_.readIndexCache_  = 0;
@@ -207,12 +346,79 @@ public:
     }
 
 private:
-    struct AlignedData {
-        alignas(details::cacheLineSize * 2) T mObj{};
-    };
-    static constexpr index_t mask_{N - 1};
+    template <typename F>
+    bool consume(F&& func, bool reportEmpty) noexcept {
+        auto readIdx  = reader_.readIndex_.load(std::memory_order_relaxed);
+        auto writeIdx = reader_.writeIndexCache_;
+        if (readIdx == writeIdx) [[unlikely]] {
+            writeIdx = reader_.writeIndexCache_
+                = writer_.writeIndex_.load(std::memory_order_acquire);
+            NSQ_PROBE(pop_refresh, this, readIdx, writeIdx);
+            if (readIdx == writeIdx) [[unlikely]] {
+                if (reportEmpty)
+                    NSQ_PROBE(pop_empty, this, readIdx);
+                return false;
+            }
+        }
+
+        sampling_.measure(slot(readIdx));
+        func(std::move(items_[slot(readIdx)].mObj));
 
-    template <typename U, std::size_t SIZE, bool heap>
+        reader_.readIndex_.store(advance(readIdx, 1), std::memory_order_release);
+
+        return true;
+    }
+
+    // For power-of-two N the cursors run freely and are masked only on slot access; at 64 bits
+    // they cannot wrap in practice. Otherwise they wrap over [0, 2N) with a conditional
+    // subtract, which still tells a full ring from an empty one. Either way w - r is the exact
+    // occupancy and all N slots are usable.
+    using cursor_t = std::uint64_t;
+    static constexpr bool     pow2_  = (N & (N - 1)) == 0;
+    static constexpr cursor_t mask_{N - 1};
+
+    static constexpr std::size_t stateAlign_
+        = Profile::smt_colocated ? alignof(details::atomic<cursor_t>) : Profile::false_sharing;
+
+    static constexpr cursor_t advance(cursor_t c, index_t n) noexcept {
+        if constexpr (pow2_) {
+            return c + n;
+        } else {
+            c += n;
+            return c >= 2 * N ? c - 2 * N : c;
+        }
+    }
+
+    static constexpr index_t slot(cursor_t c) noexcept {
+        if constexpr (pow2_)
+            return static_cast<index_t>(c & mask_);
+        else
+            return static_cast<index_t>(c >= N ? c - N : c);
+    }
+
+    static constexpr index_t distance(cursor_t to, cursor_t from) noexcept {
+        if constexpr (pow2_)
+            return static_cast<index_t>(to - from);
+        else
+            return static_cast<index_t>(to >= from ? to - from : to + 2 * N - from);
+    }
+
+    std::byte* slot_bytes(index_t idx) noexcept {
+        return reinterpret_cast<std::byte*>(&items_[idx].mObj);
+    }
+    static std::byte* as_bytes(T* p) noexcept { return reinterpret_cast<std::byte*>(p); }
+    static const std::byte* as_bytes(T const* p) noexcept {
+        return reinterpret_cast<const std::byte*>(p);
+    }
+
+    static AlignedData* checked_buffer(void* buffer, std::size_t bytes) {
+        if (buffer == nullptr || bytes < required_bytes()
+            || reinterpret_cast<std::uintptr_t>(buffer) % required_alignment() != 0)
+            throw std::invalid_argument("spsc_queue: buffer too small or misaligned");
+        return static_cast<AlignedData*>(buffer);
+    }
+
+    template <typename U, std::size_t SIZE, bool Inline>
     struct queue_storage;
 
     template <typename U, std::size_t SIZE>
@@ -223,22 +429,52 @@ private:
     };
     template <typename U, std::size_t SIZE>
     struct queue_storage<U, SIZE, false> {
-        std::unique_ptr<U[]> data;
-        queue_storage()
-            : data(std::make_unique<U[]>(SIZE)) {}
+        using traits = std::allocator_traits<slot_allocator>;
+
+        [[no_unique_address]] slot_allocator alloc;
+        U*                                   data;
+        bool                                 owned;
+
+        queue_storage() requires(!std::is_same_v<slot_allocator, details::no_allocator>)
+            : queue_storage(slot_allocator()) {}
+        explicit queue_storage(slot_allocator const& a)
+            : alloc(a)
+            , data(traits::allocate(alloc, SIZE))
+            , owned(true) {
+            try {
+                std::uninitialized_value_construct_n(data, SIZE);
+            } catch (...) {
+                traits::deallocate(alloc, data, SIZE);
+                throw;
+            }
+        }
+        explicit queue_storage(U* buffer)
+            : data(buffer)
+            , owned(false) {
+            std::uninitialized_value_construct_n(data, SIZE);
+        }
+        ~queue_storage() {
+            std::destroy_n(data, SIZE);
+            if constexpr (!std::is_same_v<slot_allocator, details::no_allocator>) {
+                if (owned)
+                    traits::deallocate(alloc, data, SIZE);
+            }
+        }
         U&       operator[](index_t idx) noexcept { return data[idx]; }
         const U& operator[](index_t idx) const noexcept { return data[idx]; }
     };
-    queue_storage<AlignedData, N, use_heap> items_;
+    queue_storage<AlignedData, N, inline_storage> items_;
 
-    struct alignas(details::cacheLineSize) ReadState {
-        std::atomic<index_t> readIndex_{0};
-        index_t              writeIndexCache_{0};
+    struct alignas(stateAlign_) ReadState {
+        details::atomic<cursor_t> readIndex_{0};
+        cursor_t                  writeIndexCache_{0};
     } reader_;
-    struct alignas(details::cacheLineSize) WriteState {
-        std::atomic<index_t> writeIndex_{0};
-        index_t              readIndexCache_{0};
+    struct alignas(stateAlign_) WriteState {
+        details::atomic<cursor_t> writeIndex_{0};
+        cursor_t                  readIndexCache_{0};
     } writer_;
+
+    [[no_unique_address]] typename Sampling::template state<N> sampling_;
 };
 
 }  // namespace nsqueue
@@ -0,0 +1,384 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <signal.h>
+#include <unistd.h>
+
+#include "detail/shared_memory.h"
+#include "hardware_profile.h"
+
+namespace nsqueue {
+
+// Counters of one queue as laid out in the shared segment. Every counter has a single writer, the
+// thread owning that side of the queue, which publishes with a relaxed load and store instead of
+// a read-modify-write, so a monitored queue pays one extra store per operation and shares no
+// cache line between producer and consumer. enqueued and dequeued are the queue's cursors.
+struct queue_stats {
+    static constexpr std::size_t name_size = 48;
+
+    enum state : std::uint32_t { free = 0, claimed = 1, live = 2 };
+
+    std::atomic<std::uint32_t> state_{free};
+    std::atomic<std::uint32_t> generation_{0};  // bumped on every claim and release
+    std::atomic<std::uint64_t> capacity_{0};
+    std::atomic<std::int64_t>  pid_{0};
+    char                       name_[name_size]{};
+
+    struct alignas(profiles::native::false_sharing) Side {
+        std::atomic<std::uint64_t> ops_{0};     // enqueued or dequeued
+        std::atomic<std::uint64_t> stalls_{0};  // found the queue full or empty
+    };
+    Side producer_;
+    Side consumer_;
+
+    static void bump(std::atomic<std::uint64_t>& counter, std::uint64_t n = 1) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "shared-memory counters must be address-free");
+
+// A consistent-enough copy of one queue's counters, as read by a monitor.
+struct queue_sample {
+    std::string   name;
+    std::int64_t  pid{};
+    std::uint64_t capacity{};
+    std::uint64_t enqueued{};
+    std::uint64_t dequeued{};
+    std::uint64_t full_stalls{};
+    std::uint64_t empty_stalls{};
+
+    // The two cursors are read independently, so a sample taken mid-operation can be off by the
+    // operations in flight.
+    [[nodiscard]] std::uint64_t depth() const noexcept {
+        return enqueued > dequeued ? std::min(enqueued - dequeued, capacity) : 0;
+    }
+};
+
+namespace details {
+
+struct stats_header {
+    static constexpr char          magic[8] = {'N', 'S', 'Q', 'S', 'T', 'A', 'T', 'S'};
+    static constexpr std::uint32_t version  = 1;
+
+    char          magic_[8];
+    std::uint32_t version_;
+    std::uint32_t slot_size_;
+    std::uint64_t slots_;
+};
+
+inline constexpr std::size_t stats_offset =
+    (sizeof(stats_header) + alignof(queue_stats) - 1) / alignof(queue_stats) * alignof(queue_stats);
+
+inline void store_name(queue_stats& s, std::string_view name) noexcept {
+    auto n = std::min(name.size(), queue_stats::name_size - 1);
+    for (std::size_t i{0}; i < queue_stats::name_size; ++i)
+        std::atomic_ref<char>(s.name_[i]).store(i < n ? name[i] : '\0', std::memory_order_relaxed);
+}
+
+inline std::string load_name(queue_stats const& s) {
+    std::string name;
+    for (std::size_t i{0}; i < queue_stats::name_size; ++i) {
+        char c = std::atomic_ref<char>(const_cast<char&>(s.name_[i])).load(std::memory_order_relaxed);
+        if (c == '\0')
+            break;
+        name.push_back(c);
+    }
+    return name;
+}
+
+// A registry's segment is named <prefix>.<pid>.<n>, n counting the registries this process
+// created, so every process (and every registry within it) has a segment of its own.
+struct stats_segment {
+    std::string  name;
+    std::int64_t pid{};
+};
+
+inline std::vector<stats_segment> list_stats_segments(const std::string& prefix) {
+    std::vector<stats_segment> out;
+    for (auto& name : list_shared_memory(prefix)) {
+        const char* p = name.c_str() + prefix.size() + (prefix.starts_with('/') ? 1 : 2);
+        char*       end{};
+        auto        pid = std::strtoll(p, &end, 10);
+        if (end == p || *end != '.' || pid <= 0)
+            continue;
+        p = end + 1;
+        std::strtoull(p, &end, 10);
+        if (end == p || *end != '\0')
+            continue;
+        out.push_back({std::move(name), pid});
+    }
+    return out;
+}
+
+inline bool process_alive(std::int64_t pid) noexcept {
+    return ::kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+}
+
+inline std::string next_stats_segment(const std::string& prefix) {
+    static std::atomic<std::uint64_t> created{0};
+    return prefix + "." + std::to_string(::getpid()) + "."
+         + std::to_string(created.fetch_add(1, std::memory_order_relaxed));
+}
+
+}  // namespace details
+
+// Releases its slot in the registry on destruction.
+class stats_handle {
+public:
+    stats_handle() = default;
+    explicit stats_handle(queue_stats* stats) noexcept : stats_(stats) {}
+
+    stats_handle(const stats_handle&)            = delete;
+    stats_handle& operator=(const stats_handle&) = delete;
+
+    stats_handle(stats_handle&& other) noexcept : stats_(std::exchange(other.stats_, nullptr)) {}
+    stats_handle& operator=(stats_handle&& other) noexcept {
+        if (this != &other) {
+            release();
+            stats_ = std::exchange(other.stats_, nullptr);
+        }
+        return *this;
+    }
+
+    ~stats_handle() { release(); }
+
+    [[nodiscard]] queue_stats* get() const noexcept { return stats_; }
+    [[nodiscard]] queue_stats* operator->() const noexcept { return stats_; }
+    [[nodiscard]] explicit operator bool() const noexcept { return stats_ != nullptr; }
+
+private:
+    void release() noexcept {
+        if (stats_ == nullptr)
+            return;
+        stats_->generation_.fetch_add(1, std::memory_order_relaxed);
+        stats_->state_.store(queue_stats::free, std::memory_order_release);
+        stats_ = nullptr;
+    }
+
+    queue_stats* stats_{nullptr};
+};
+
+// Owns a shared-memory segment with room for a fixed number of queues. Registration is the only
+// operation that synchronizes; the counters themselves are plain relaxed stores. The segment is
+// named <prefix>.<pid>.<n>, so processes publishing under the same prefix never share or
+// replace each other's segments; a monitor finds them all with stats_view::segments(prefix).
+// It is removed when the registry is destroyed, and segments under the same prefix that were
+// left behind by processes that no longer exist are removed when a registry is created.
+class stats_registry {
+public:
+    static constexpr const char* default_name = "/nsqueue-stats";
+
+    explicit stats_registry(std::string prefix = default_name, std::size_t slots = 64)
+        : shm_(create(prefix, slots)) {
+        auto* header       = new (shm_.data()) details::stats_header{};
+        header->version_   = details::stats_header::version;
+        header->slot_size_ = sizeof(queue_stats);
+        header->slots_     = slots;
+        for (std::size_t i{0}; i < slots; ++i)
+            new (shm_.data() + details::stats_offset + i * sizeof(queue_stats)) queue_stats{};
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(header->magic_, details::stats_header::magic, sizeof(header->magic_));
+        slots_ = slots;
+    }
+
+    stats_registry(const stats_registry&)            = delete;
+    stats_registry& operator=(const stats_registry&) = delete;
+
+    // Claims a slot for `name`; names longer than 47 bytes are truncated. Throws
+    // std::length_error when every slot is in use.
+    [[nodiscard]] stats_handle add(std::string_view name, std::uint64_t capacity) {
+        for (std::size_t i{0}; i < slots_; ++i) {
+            auto*         s        = slot(i);
+            std::uint32_t expected = queue_stats::free;
+            if (!s->state_.compare_exchange_strong(expected, queue_stats::claimed,
+                                                   std::memory_order_acquire))
+                continue;
+            s->generation_.fetch_add(1, std::memory_order_relaxed);
+            details::store_name(*s, name);
+            s->capacity_.store(capacity, std::memory_order_relaxed);
+            s->pid_.store(::getpid(), std::memory_order_relaxed);
+            for (auto* side : {&s->producer_, &s->consumer_}) {
+                side->ops_.store(0, std::memory_order_relaxed);
+                side->stalls_.store(0, std::memory_order_relaxed);
+            }
+            s->state_.store(queue_stats::live, std::memory_order_release);
+            return stats_handle(s);
+        }
+        throw std::length_error("stats registry is full");
+    }
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return slots_; }
+
+    // The segment's full name, for stats_view.
+    [[nodiscard]] std::string const& name() const noexcept { return shm_.name(); }
+
+private:
+    static details::shared_memory create(std::string const& prefix, std::size_t slots) {
+        for (auto const& seg : details::list_stats_segments(prefix))
+            if (!details::process_alive(seg.pid))
+                ::shm_unlink(seg.name.c_str());
+        return details::shared_memory::create(details::next_stats_segment(prefix),
+                                              details::stats_offset + slots * sizeof(queue_stats));
+    }
+
+    queue_stats* slot(std::size_t i) const noexcept {
+        return std::launder(reinterpret_cast<queue_stats*>(shm_.data() + details::stats_offset
+                                                           + i * sizeof(queue_stats)));
+    }
+
+    details::shared_memory shm_;
+    std::size_t            slots_{0};
+};
+
+// Read-only view of a registry, possibly in another process.
+class stats_view {
+public:
+    // Segments of live processes published under `prefix`.
+    [[nodiscard]] static std::vector<std::string>
+    segments(const std::string& prefix = stats_registry::default_name) {
+        std::vector<std::string> names;
+        for (auto& seg : details::list_stats_segments(prefix))
+            if (details::process_alive(seg.pid))
+                names.push_back(std::move(seg.name));
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    // Opens one segment by its full name, as returned by segments() or stats_registry::name().
+    // Throws std::system_error if the segment does not exist and std::runtime_error if it was
+    // written by an incompatible build or is still being set up.
+    explicit stats_view(const std::string& name)
+        : shm_(details::shared_memory::open(name)) {
+        auto const* header = reinterpret_cast<details::stats_header const*>(shm_.data());
+        if (shm_.size() < details::stats_offset
+            || std::memcmp(header->magic_, details::stats_header::magic, sizeof(header->magic_)) != 0
+            || header->version_ != details::stats_header::version
+            || header->slot_size_ != sizeof(queue_stats)
+            || shm_.size() < details::stats_offset + header->slots_ * sizeof(queue_stats))
+            throw std::runtime_error("incompatible stats segment " + name);
+        slots_ = header->slots_;
+    }
+
+    // Live queues at the time of the call. A slot that is released or re-registered while it is
+    // being read is skipped.
+    [[nodiscard]] std::vector<queue_sample> sample() const {
+        std::vector<queue_sample> out;
+        for (std::size_t i{0}; i < slots_; ++i) {
+            auto const* s = reinterpret_cast<queue_stats const*>(
+                shm_.data() + details::stats_offset + i * sizeof(queue_stats));
+            if (s->state_.load(std::memory_order_acquire) != queue_stats::live)
+                continue;
+            auto         gen = s->generation_.load(std::memory_order_acquire);
+            queue_sample q;
+            q.name         = details::load_name(*s);
+            q.pid          = s->pid_.load(std::memory_order_relaxed);
+            q.capacity     = s->capacity_.load(std::memory_order_relaxed);
+            q.dequeued     = s->consumer_.ops_.load(std::memory_order_relaxed);
+            q.enqueued     = s->producer_.ops_.load(std::memory_order_relaxed);
+            q.full_stalls  = s->producer_.stalls_.load(std::memory_order_relaxed);
+            q.empty_stalls = s->consumer_.stalls_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s->generation_.load(std::memory_order_relaxed) != gen
+                || s->state_.load(std::memory_order_relaxed) != queue_stats::live)
+                continue;
+            out.push_back(std::move(q));
+        }
+        return out;
+    }
+
+private:
+    details::shared_memory shm_;
+    std::size_t            slots_{0};
+};
+
+// Wraps a queue with the spsc_queue interface and publishes its traffic to a registry. A failed
+// push or pop counts as a stall; force_push and force_pop count one stall per wait, not per spin.
+template <typename Q>
+class monitored_queue {
+public:
+    monitored_queue(Q& queue, stats_registry& registry, std::string_view name)
+        : queue_(queue)
+        , stats_(registry.add(name, queue.capacity())) {}
+
+    template <typename T>
+    [[nodiscard]] bool push(T&& item) {
+        if (!queue_.push(std::forward<T>(item))) [[unlikely]] {
+            queue_stats::bump(stats_->producer_.stalls_);
+            return false;
+        }
+        queue_stats::bump(stats_->producer_.ops_);
+        return true;
+    }
+
+    template <typename T>
+    void force_push(T const& item) {
+        if (!queue_.push(item)) [[unlikely]] {
+            queue_stats::bump(stats_->producer_.stalls_);
+            queue_.force_push(item);
+        }
+        queue_stats::bump(stats_->producer_.ops_);
+    }
+
+    template <typename T>
+    [[nodiscard]] bool pop(T& item) {
+        if (!queue_.pop(item)) [[unlikely]] {
+            queue_stats::bump(stats_->consumer_.stalls_);
+            return false;
+        }
+        queue_stats::bump(stats_->consumer_.ops_);
+        return true;
+    }
+
+    template <typename T>
+    void force_pop(T& item) {
+        if (!queue_.pop(item)) [[unlikely]] {
+            queue_stats::bump(stats_->consumer_.stalls_);
+            queue_.force_pop(item);
+        }
+        queue_stats::bump(stats_->consumer_.ops_);
+    }
+
+    template <typename F>
+    bool consume_one(F&& func) {
+        if (!queue_.consume_one(std::forward<F>(func))) [[unlikely]] {
+            queue_stats::bump(stats_->consumer_.stalls_);
+            return false;
+        }
+        queue_stats::bump(stats_->consumer_.ops_);
+        return true;
+    }
+
+    template <typename F>
+    std::size_t consume_all(F&& func) {
+        std::size_t n = queue_.consume_all(std::forward<F>(func));
+        if (n == 0) [[unlikely]]
+            queue_stats::bump(stats_->consumer_.stalls_);
+        else
+            queue_stats::bump(stats_->consumer_.ops_, n);
+        return n;
+    }
+
+    [[nodiscard]] Q& queue() noexcept { return queue_; }
+    [[nodiscard]] queue_stats const& stats() const noexcept { return *stats_.get(); }
+
+private:
+    Q&           queue_;
+    stats_handle stats_;
+};
+
+}  // namespace nsqueue
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "affinity.h"
+#include "detail/cache_utils.h"
+#include "detail/mpmc_ring.h"
+#include "detail/spin_wait.h"
+#include "detail/work_stealing_deque.h"
+
+namespace nsqueue {
+
+namespace details {
+
+struct task_base {
+    virtual ~task_base()      = default;
+    virtual void run() noexcept = 0;
+};
+
+template <typename F>
+struct task final : task_base {
+    explicit task(F&& f)
+        : func_(std::move(f)) {}
+    explicit task(const F& f)
+        : func_(f) {}
+    void run() noexcept override { func_(); }
+    F    func_;
+};
+
+}  // namespace details
+
+// Work-stealing pool. Each worker owns a Chase-Lev deque that tasks submitted from inside the
+// pool go to; submissions from other threads go through a shared MPMC injection ring. Idle
+// workers steal from their siblings, spin for a while, and finally park on an event count.
+// Tasks must not throw: an escaping exception terminates the program.
+class thread_pool {
+public:
+    static constexpr std::size_t   local_capacity  = 1024;
+    static constexpr std::size_t   inject_capacity = 4096;
+    static constexpr std::uint32_t spin_limit      = 1 << 12;
+
+    thread_pool()
+        : thread_pool(std::thread::hardware_concurrency()) {}
+
+    // Worker i is pinned to cpus[i % cpus.size()] when cpus is non-empty. Throws
+    // std::system_error if a worker cannot be pinned to its cpu, e.g. one outside the affinity
+    // mask or offline; a negative cpu leaves that worker unpinned.
+    explicit thread_pool(std::size_t threads, std::vector<int> cpus = {}) {
+        if (threads == 0)
+            threads = 1;
+        workers_.reserve(threads);
+        for (std::size_t i{0}; i < threads; ++i)
+            workers_.push_back(std::make_unique<Worker>());
+        for (std::size_t i{0}; i < threads; ++i)
+            workers_[i]->thread_ = std::thread([this, i] { run_worker(i); });
+
+        for (std::size_t i{0}; i < threads && !cpus.empty(); ++i) {
+            int cpu = cpus[i % cpus.size()];
+            if (!pin_thread(workers_[i]->thread_, cpu)) {
+                shutdown();
+                throw std::system_error(EINVAL, std::generic_category(),
+                                        "cannot pin worker to cpu " + std::to_string(cpu));
+            }
+        }
+    }
+
+    thread_pool(const thread_pool&)            = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+    thread_pool(thread_pool&&)                 = delete;
+    thread_pool& operator=(thread_pool&&)      = delete;
+
+    // Runs every task that was submitted before destruction, then joins the workers.
+    ~thread_pool() { shutdown(); }
+
+    template <typename F>
+    void submit(F&& func) {
+        using task_t = details::task<std::decay_t<F>>;
+        details::task_base* t = new task_t(std::forward<F>(func));
+
+        if (current_ != nullptr && current_->pool_ == this) {
+            // A worker must not wait for room in the ring: if every worker is submitting, nobody
+            // is left to drain it. Run the task here instead.
+            if (!workers_[current_->index_]->local_.push(t) && !inject_.push(t)) {
+                t->run();
+                delete t;
+                return;
+            }
+        } else {
+            push_injected(t);
+        }
+        parking_.notify_one();
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return workers_.size(); }
+
+private:
+    struct alignas(details::falseSharingSize) Worker {
+        details::work_stealing_deque<details::task_base*, local_capacity> local_;
+        std::thread                                                       thread_;
+    };
+
+    struct Context {
+        thread_pool* pool_;
+        std::size_t  index_;
+    };
+
+    static inline thread_local Context* current_ = nullptr;
+
+    void shutdown() noexcept {
+        stop_.store(true, std::memory_order_release);
+        parking_.notify_all();
+        for (auto& w : workers_)
+            w->thread_.join();
+    }
+
+    void push_injected(details::task_base* t) noexcept {
+        while (!inject_.push(t))
+            std::this_thread::yield();
+    }
+
+    details::task_base* find_task(std::size_t self) noexcept {
+        details::task_base* t{nullptr};
+        if (workers_[self]->local_.pop(t))
+            return t;
+        if (inject_.pop(t))
+            return t;
+        const auto n = workers_.size();
+        for (std::size_t k{1}; k < n; ++k) {
+            if (workers_[(self + k) % n]->local_.steal(t))
+                return t;
+        }
+        return nullptr;
+    }
+
+    void run_worker(std::size_t self) noexcept {
+        Context ctx{this, self};
+        current_ = &ctx;
+
+        std::uint32_t spins{0};
+        for (;;) {
+            if (auto* t = find_task(self)) {
+                t->run();
+                delete t;
+                spins = 0;
+                continue;
+            }
+            if (spins < spin_limit) {
+                ++spins;
+                details::cpu_relax();
+                continue;
+            }
+
+            auto key = parking_.prepare_wait();
+            if (auto* t = find_task(self)) {
+                parking_.cancel_wait();
+                t->run();
+                delete t;
+                spins = 0;
+                continue;
+            }
+            if (stop_.load(std::memory_order_acquire)) {
+                parking_.cancel_wait();
+                break;
+            }
+            parking_.wait(key);
+            spins = 0;
+        }
+        current_ = nullptr;
+    }
+
+    std::vector<std::unique_ptr<Worker>>                        workers_;
+    details::mpmc_ring<details::task_base*, inject_capacity>    inject_;
+    alignas(details::falseSharingSize) details::event_count        parking_;
+    alignas(details::falseSharingSize) std::atomic<bool>           stop_{false};
+};
+
+}  // namespace nsqueue
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+#include "affinity.h"
+
+namespace nsqueue {
+
+// Parses a kernel cpu list such as "0-3,8,10-11". Throws std::invalid_argument if malformed.
+inline std::vector<int> parse_cpu_list(std::string_view text) {
+    auto to_int = [&](std::string_view s) {
+        int  value{};
+        auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+        if (ec != std::errc{} || end != s.data() + s.size() || s.empty())
+            throw std::invalid_argument("malformed cpu list: " + std::string(text));
+        return value;
+    };
+
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back())))
+        text.remove_suffix(1);
+
+    std::vector<int> cpus;
+    for (std::string_view rest = text; !rest.empty();) {
+        auto comma = rest.find(',');
+        auto item  = rest.substr(0, comma);
+        rest       = comma == std::string_view::npos ? std::string_view{} : rest.substr(comma + 1);
+
+        auto dash = item.find('-');
+        int  lo   = to_int(item.substr(0, dash));
+        int  hi   = dash == std::string_view::npos ? lo : to_int(item.substr(dash + 1));
+        if (hi < lo)
+            throw std::invalid_argument("malformed cpu list: " + std::string(text));
+        for (int cpu = lo; cpu <= hi; ++cpu)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+// Cpus the calling thread may run on, or an empty list where that cannot be queried.
+inline std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &set))
+                cpus.push_back(cpu);
+    }
+#endif
+    return cpus;
+}
+
+struct cpu_info {
+    int              id{};
+    int              core{};      // lowest cpu of the physical core, shared by SMT siblings
+    int              package{};
+    int              llc{-1};     // lowest cpu sharing the last-level cache, -1 if unreported
+    int              node{0};     // NUMA node
+    std::vector<int> siblings;    // SMT siblings, including this cpu
+};
+
+enum class placement {
+    smt_sibling,   // two hyperthreads of one core
+    shared_cache,  // distinct cores behind the same last-level cache
+    same_node,     // distinct last-level caches on one NUMA node
+    cross_node,    // different NUMA nodes
+};
+
+struct core_pair {
+    int producer{-1};
+    int consumer{-1};
+};
+
+// Snapshot of the cpu topology read from sysfs. The root is a parameter so that it can be
+// pointed at a copy of another machine's /sys/devices/system.
+class topology {
+public:
+    // Throws std::runtime_error if the list of online cpus cannot be read.
+    static topology discover(std::filesystem::path const& root = "/sys/devices/system") {
+        namespace fs = std::filesystem;
+        topology t;
+
+        auto online = read_file(root / "cpu" / "online");
+        if (!online)
+            throw std::runtime_error("cannot read " + (root / "cpu" / "online").string());
+
+        for (int id : parse_cpu_list(*online)) {
+            auto     dir = root / "cpu" / ("cpu" + std::to_string(id));
+            cpu_info cpu;
+            cpu.id = id;
+
+            auto siblings = read_file(dir / "topology" / "thread_siblings_list");
+            cpu.siblings  = siblings ? parse_cpu_list(*siblings) : std::vector<int>{id};
+            cpu.core      = *std::min_element(cpu.siblings.begin(), cpu.siblings.end());
+            if (auto pkg = read_file(dir / "topology" / "physical_package_id"))
+                cpu.package = std::stoi(*pkg);
+
+            int level{0};
+            for (int index{0};; ++index) {
+                auto cache = dir / "cache" / ("index" + std::to_string(index));
+                if (!fs::exists(cache))
+                    break;
+                auto lvl    = read_file(cache / "level");
+                auto shared = read_file(cache / "shared_cpu_list");
+                if (!lvl || !shared || std::stoi(*lvl) < level)
+                    continue;
+                auto list = parse_cpu_list(*shared);
+                if (list.empty())
+                    continue;
+                level   = std::stoi(*lvl);
+                cpu.llc = *std::min_element(list.begin(), list.end());
+            }
+            t.cpus_.push_back(std::move(cpu));
+        }
+
+        std::error_code ec;
+        for (auto const& entry : fs::directory_iterator(root / "node", ec)) {
+            auto name = entry.path().filename().string();
+            if (name.rfind("node", 0) != 0 || name.size() == 4
+                || !std::isdigit(static_cast<unsigned char>(name[4])))
+                continue;
+            auto list = read_file(entry.path() / "cpulist");
+            if (!list)
+                continue;
+            int node = std::stoi(name.substr(4));
+            for (int id : parse_cpu_list(*list))
+                if (auto* cpu = t.find_mutable(id))
+                    cpu->node = node;
+        }
+        return t;
+    }
+
+    [[nodiscard]] std::vector<cpu_info> const& cpus() const noexcept { return cpus_; }
+
+    [[nodiscard]] cpu_info const* find(int id) const noexcept {
+        auto it = std::find_if(cpus_.begin(), cpus_.end(),
+                               [id](auto const& c) { return c.id == id; });
+        return it == cpus_.end() ? nullptr : &*it;
+    }
+
+    // Cpus grouped by physical core, last-level cache and NUMA node respectively.
+    [[nodiscard]] std::vector<std::vector<int>> cores() const { return group_by(&cpu_info::core); }
+    [[nodiscard]] std::vector<std::vector<int>> llc_domains() const {
+        return group_by(&cpu_info::llc);
+    }
+    [[nodiscard]] std::vector<std::vector<int>> numa_nodes() const {
+        return group_by(&cpu_info::node);
+    }
+
+    // Picks up to count producer/consumer pairs with the requested relationship, restricted to
+    // `allowed` when it is non-empty. Pairs never share a physical core with each other, so
+    // concurrent queues do not compete for one core's execution resources.
+    [[nodiscard]] std::vector<core_pair>
+    recommend_pairs(std::size_t             count,
+                    placement               where   = placement::shared_cache,
+                    std::vector<int> const& allowed = {}) const {
+        std::vector<core_pair> pairs;
+        std::set<int>          usedCores;
+        auto usable = [&](cpu_info const& c) {
+            return !usedCores.count(c.core)
+                && (allowed.empty()
+                    || std::find(allowed.begin(), allowed.end(), c.id) != allowed.end());
+        };
+
+        while (pairs.size() < count) {
+            std::optional<core_pair> found;
+            for (auto const& p : cpus_) {
+                if (!usable(p))
+                    continue;
+                for (auto const& c : cpus_) {
+                    if (c.id != p.id && usable(c) && related(p, c, where)) {
+                        found = core_pair{p.id, c.id};
+                        break;
+                    }
+                }
+                if (found)
+                    break;
+            }
+            if (!found)
+                break;
+            usedCores.insert(find(found->producer)->core);
+            usedCores.insert(find(found->consumer)->core);
+            pairs.push_back(*found);
+        }
+        return pairs;
+    }
+
+    [[nodiscard]] std::optional<core_pair>
+    recommend_pair(placement               where   = placement::shared_cache,
+                   std::vector<int> const& allowed = {}) const {
+        auto pairs = recommend_pairs(1, where, allowed);
+        return pairs.empty() ? std::nullopt : std::optional<core_pair>(pairs.front());
+    }
+
+private:
+    static std::optional<std::string> read_file(std::filesystem::path const& path) {
+        std::ifstream in(path);
+        if (!in)
+            return std::nullopt;
+        std::string line;
+        std::getline(in, line);
+        return line;
+    }
+
+    static bool related(cpu_info const& p, cpu_info const& c, placement where) noexcept {
+        switch (where) {
+        case placement::smt_sibling:
+            return p.core == c.core;
+        case placement::shared_cache:
+            return p.core != c.core && p.llc == c.llc;
+        case placement::same_node:
+            return p.llc != c.llc && p.node == c.node;
+        case placement::cross_node:
+            return p.node != c.node;
+        }
+        return false;
+    }
+
+    cpu_info* find_mutable(int id) noexcept { return const_cast<cpu_info*>(find(id)); }
+
+    std::vector<std::vector<int>> group_by(int cpu_info::*key) const {
+        std::vector<std::vector<int>> groups;
+        std::vector<int>              keys;
+        for (auto const& c : cpus_) {
+            auto it = std::find(keys.begin(), keys.end(), c.*key);
+            if (it == keys.end()) {
+                keys.push_back(c.*key);
+                groups.push_back({c.id});
+            } else {
+                groups[static_cast<std::size_t>(it - keys.begin())].push_back(c.id);
+            }
+        }
+        return groups;
+    }
+
+    std::vector<cpu_info> cpus_;
+};
+
+struct thread_placement {
+    int  cpu{-1};            // -1 leaves affinity alone
+    int  fifo_priority{0};   // > 0 switches the thread to SCHED_FIFO at this priority
+    bool lock_memory{false}; // mlockall(MCL_CURRENT | MCL_FUTURE); affects the whole process
+};
+
+namespace details {
+
+#if defined(__linux__)
+inline bool apply_placement(pthread_t thread, thread_placement const& where) noexcept {
+    bool ok = pin_thread(thread, where.cpu);
+    if (where.fifo_priority > 0) {
+        sched_param param{};
+        param.sched_priority = where.fifo_priority;
+        ok &= pthread_setschedparam(thread, SCHED_FIFO, &param) == 0;
+    }
+    if (where.lock_memory)
+        ok &= mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+    return ok;
+}
+#endif
+
+}  // namespace details
+
+// Applies every requested setting and returns false if any of them failed (SCHED_FIFO and
+// mlockall usually need CAP_SYS_NICE / CAP_IPC_LOCK or matching rlimits).
+inline bool apply_placement(std::thread& t, thread_placement const& where) noexcept {
+#if defined(__linux__)
+    return details::apply_placement(t.native_handle(), where);
+#else
+    (void)t;
+    return where.cpu < 0 && where.fifo_priority <= 0 && !where.lock_memory;
+#endif
+}
+
+inline bool apply_placement(thread_placement const& where) noexcept {
+#if defined(__linux__)
+    return details::apply_placement(pthread_self(), where);
+#else
+    return where.cpu < 0 && where.fifo_priority <= 0 && !where.lock_memory;
+#endif
+}
+
+}  // namespace nsqueue
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "detail/cache_utils.h"
+
+namespace nsqueue {
+
+struct trace_event {
+    std::uint64_t time_ns;  // since the start of the recording
+    std::uint32_t bytes;    // payload size
+};
+
+// Enqueue and dequeue timelines of one queue. On disk each timeline is a count followed by
+// (delta_ns, bytes) pairs encoded as LEB128 varints, so a steady stream of small messages costs
+// two to four bytes per event.
+struct traffic_trace {
+    std::vector<trace_event> enqueues;
+    std::vector<trace_event> dequeues;
+
+    void save(const std::filesystem::path& path) const {
+        std::vector<std::uint8_t> out;
+        out.insert(out.end(), std::begin(magic), std::end(magic));
+        put_varint(out, version);
+        put_events(out, enqueues);
+        put_events(out, dequeues);
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+        if (!file)
+            throw std::runtime_error("failed to write trace " + path.string());
+    }
+
+    [[nodiscard]] static traffic_trace load(const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("failed to open trace " + path.string());
+        std::vector<std::uint8_t> in((std::istreambuf_iterator<char>(file)),
+                                     std::istreambuf_iterator<char>());
+
+        std::size_t pos{sizeof(magic)};
+        if (in.size() < sizeof(magic) || std::memcmp(in.data(), magic, sizeof(magic)) != 0)
+            throw std::runtime_error("not a trace file: " + path.string());
+        if (get_varint(in, pos) != version)
+            throw std::runtime_error("unsupported trace version: " + path.string());
+
+        traffic_trace trace;
+        trace.enqueues = get_events(in, pos);
+        trace.dequeues = get_events(in, pos);
+        return trace;
+    }
+
+private:
+    static constexpr char          magic[8] = {'N', 'S', 'Q', 'T', 'R', 'A', 'C', 'E'};
+    static constexpr std::uint64_t version  = 1;
+
+    static void put_varint(std::vector<std::uint8_t>& out, std::uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(static_cast<std::uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<std::uint8_t>(v));
+    }
+
+    static std::uint64_t get_varint(const std::vector<std::uint8_t>& in, std::size_t& pos) {
+        std::uint64_t v{0};
+        for (unsigned shift{0}; shift < 64; shift += 7) {
+            if (pos == in.size())
+                throw std::runtime_error("truncated trace");
+            auto b = in[pos++];
+            v |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+                return v;
+        }
+        throw std::runtime_error("malformed varint in trace");
+    }
+
+    static void put_events(std::vector<std::uint8_t>& out, const std::vector<trace_event>& events) {
+        put_varint(out, events.size());
+        std::uint64_t prev{0};
+        for (auto const& e : events) {
+            put_varint(out, e.time_ns - prev);
+            put_varint(out, e.bytes);
+            prev = e.time_ns;
+        }
+    }
+
+    static std::vector<trace_event> get_events(const std::vector<std::uint8_t>& in,
+                                               std::size_t&                     pos) {
+        auto                     n = get_varint(in, pos);
+        std::vector<trace_event> events;
+        events.reserve(n);
+        std::uint64_t t{0};
+        for (std::uint64_t i{0}; i < n; ++i) {
+            t += get_varint(in, pos);
+            events.push_back({t, static_cast<std::uint32_t>(get_varint(in, pos))});
+        }
+        return events;
+    }
+};
+
+struct payload_sizeof {
+    template <typename T>
+    std::uint32_t operator()(T const&) const noexcept {
+        return sizeof(T);
+    }
+};
+
+// Wraps a queue with the spsc_queue interface and timestamps every successful enqueue and
+// dequeue. Each side appends to its own timeline, so recording adds no sharing between the
+// producer and the consumer. Read trace() or call save() only after both threads are done.
+template <typename Q, typename SizeFn = payload_sizeof>
+class recording_queue {
+    using clock = std::chrono::steady_clock;
+
+public:
+    explicit recording_queue(Q& queue, SizeFn size = {}, std::size_t reserve = 1 << 20)
+        : queue_(queue)
+        , size_(std::move(size))
+        , start_(clock::now()) {
+        producer_.events_.reserve(reserve);
+        consumer_.events_.reserve(reserve);
+    }
+
+    template <typename T>
+    [[nodiscard]] bool push(T const& item) {
+        if (!queue_.push(item))
+            return false;
+        producer_.events_.push_back({now(), size_(item)});
+        return true;
+    }
+
+    template <typename T>
+    void force_push(T const& item) {
+        queue_.force_push(item);
+        producer_.events_.push_back({now(), size_(item)});
+    }
+
+    template <typename T>
+    [[nodiscard]] bool pop(T& item) {
+        if (!queue_.pop(item))
+            return false;
+        consumer_.events_.push_back({now(), size_(item)});
+        return true;
+    }
+
+    template <typename T>
+    void force_pop(T& item) {
+        queue_.force_pop(item);
+        consumer_.events_.push_back({now(), size_(item)});
+    }
+
+    template <typename F>
+    bool consume_one(F&& func) {
+        return queue_.consume_one([&](auto&& item) {
+            consumer_.events_.push_back({now(), size_(item)});
+            func(std::forward<decltype(item)>(item));
+        });
+    }
+
+    [[nodiscard]] Q& queue() noexcept { return queue_; }
+
+    [[nodiscard]] traffic_trace trace() const { return {producer_.events_, consumer_.events_}; }
+
+    void save(const std::filesystem::path& path) const { trace().save(path); }
+
+private:
+    std::uint64_t now() const noexcept {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start_).count());
+    }
+
+    struct alignas(details::falseSharingSize) Timeline {
+        std::vector<trace_event> events_;
+    };
+
+    Q&                queue_;
+    SizeFn            size_;
+    clock::time_point start_;
+    Timeline          producer_;
+    Timeline          consumer_;
+};
+
+}  // namespace nsqueue
@@ -0,0 +1,100 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "conflating_queue.h"
+
+struct quote {
+    double   bid;
+    double   ask;
+    uint64_t seq;
+};
+
+TEST_CASE("conflating_queue keeps last value per key", "[unit]") {
+    nsqueue::conflating_queue<quote, 16> q;
+    REQUIRE(q.empty());
+
+    q.push(3, {1.0, 2.0, 1});
+    q.push(5, {5.0, 6.0, 2});
+    q.push(3, {1.5, 2.5, 3});
+    REQUIRE(q.size() == 2);
+
+    uint32_t key{};
+    quote    value{};
+    REQUIRE(q.pop(key, value));
+    REQUIRE(key == 3);
+    REQUIRE(value.seq == 3);
+    REQUIRE(value.bid == 1.5);
+
+    REQUIRE(q.pop(key, value));
+    REQUIRE(key == 5);
+    REQUIRE(value.seq == 2);
+
+    REQUIRE(q.empty());
+    REQUIRE_FALSE(q.pop(key, value));
+};
+
+TEST_CASE("conflating_queue key becomes dirty again after consume", "[unit]") {
+    nsqueue::conflating_queue<int, 4> q;
+    q.push(1, 10);
+
+    int seen{0};
+    REQUIRE(q.consume_one([&](uint32_t, int v) { seen = v; }));
+    REQUIRE(seen == 10);
+
+    q.push(1, 11);
+    REQUIRE(q.size() == 1);
+    REQUIRE(q.consume_one([&](uint32_t, int v) { seen = v; }));
+    REQUIRE(seen == 11);
+};
+
+TEST_CASE("conflating_queue every key at once", "[unit]") {
+    constexpr uint32_t                          keys = 64;
+    nsqueue::conflating_queue<uint32_t, keys>   q;
+    for (int round{0}; round < 3; ++round)
+        for (uint32_t k{0}; k < keys; ++k)
+            q.push(k, k * 100 + round);
+    REQUIRE(q.size() == keys);
+
+    auto n = q.consume_all([&](uint32_t k, uint32_t v) { REQUIRE(v == k * 100 + 2); });
+    REQUIRE(n == keys);
+    REQUIRE(q.empty());
+};
+
+TEST_CASE("conflating_queue stress", "[stress]") {
+    constexpr uint32_t keys    = 32;
+    constexpr uint64_t updates = 500'000;
+    nsqueue::conflating_queue<quote, keys> q;
+
+    std::atomic<bool> done{false};
+
+    std::thread producer([&] {
+        for (uint64_t i{1}; i <= updates; ++i) {
+            double px = static_cast<double>(i);
+            q.push(static_cast<uint32_t>(i % keys), {px, px + 1, i});
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    std::thread consumer([&] {
+        std::vector<uint64_t> last(keys, 0);
+        auto check = [&](uint32_t k, quote const& v) {
+            if (v.bid != static_cast<double>(v.seq) || v.ask != v.bid + 1)
+                FAIL("torn read");
+            if (v.seq < last[k] || v.seq % keys != k)
+                FAIL("stale or misrouted value");
+            last[k] = v.seq;
+        };
+        while (!done.load(std::memory_order_acquire))
+            q.consume_all(check);
+        q.consume_all(check);
+        for (uint32_t k{0}; k < keys; ++k)
+            REQUIRE(last[k] == updates - ((updates - k) % keys));
+    });
+
+    producer.join();
+    consumer.join();
+};
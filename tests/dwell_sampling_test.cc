@@ -0,0 +1,144 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+#include "histogram.h"
+#include "spsc_queue.h"
+
+template <typename T, std::size_t N, std::size_t K>
+using sampled_queue
+    = nsqueue::spsc_queue<T, N, std::allocator<T>, nsqueue::profiles::native,
+                          nsqueue::dwell_sampling<K>>;
+
+TEST_CASE("log_linear_histogram buckets", "[unit]") {
+    using histogram = nsqueue::log_linear_histogram<4, 40>;
+
+    for (std::uint64_t v : {0ull, 1ull, 15ull, 16ull, 17ull, 31ull, 32ull, 1000ull, 123456789ull,
+                            (1ull << 40) - 1}) {
+        auto i = histogram::bucket_index(v);
+        REQUIRE(i < histogram::bucket_count);
+        REQUIRE(histogram::bucket_lower(i) <= v);
+        REQUIRE(histogram::bucket_upper(i) >= v);
+        // Within 1/16 of the value.
+        REQUIRE(histogram::bucket_upper(i) - histogram::bucket_lower(i) <= v / 16);
+    }
+    for (std::size_t i{1}; i < histogram::bucket_count; ++i)
+        REQUIRE(histogram::bucket_lower(i) == histogram::bucket_upper(i - 1) + 1);
+    REQUIRE(histogram::bucket_index(1ull << 50) == histogram::bucket_count - 1);
+
+    auto h = std::make_unique<histogram>();
+    for (std::uint64_t v{1}; v <= 100; ++v)
+        h->record(v);
+    auto s = h->snapshot();
+    REQUIRE(s.total() == 100);
+    REQUIRE(s.percentile(0.0) == 1);
+    REQUIRE(s.percentile(0.5) >= 50);
+    REQUIRE(s.percentile(0.5) <= 53);
+    REQUIRE(s.max() >= 100);
+    REQUIRE(s.max() <= 103);
+    h->reset();
+    REQUIRE(h->snapshot().total() == 0);
+};
+
+TEST_CASE("no_sampling adds no state", "[unit]") {
+    REQUIRE(std::is_empty_v<nsqueue::no_sampling::state<1024>>);
+    REQUIRE(sizeof(nsqueue::spsc_queue<int, 16>)
+            == sizeof(nsqueue::spsc_queue<int, 16, std::allocator<int>, nsqueue::profiles::native,
+                                          nsqueue::no_sampling>));
+};
+
+TEST_CASE("dwell sampling records every K-th slot", "[unit]") {
+    auto q = std::make_unique<sampled_queue<int, 16, 4>>();
+
+    for (int i{0}; i < 16; ++i)
+        REQUIRE(q->push(i));
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    int val{};
+    for (int i{0}; i < 16; ++i)
+        REQUIRE(q->pop(val));
+
+    auto s = q->dwell_histogram().snapshot();
+    REQUIRE(s.total() == 4);
+    REQUIRE(s.percentile(0.0) >= 1'800'000);
+    REQUIRE(s.max() < 1'000'000'000);
+
+    // Every pop flavour measures.
+    for (int lap{0}; lap < 2; ++lap) {
+        for (int i{0}; i < 4; ++i)
+            q->force_push(i);
+        q->force_pop(val);
+        REQUIRE(q->pop());
+        q->force_pop();
+        REQUIRE(q->consume_one([](int) {}));
+    }
+    REQUIRE(q->dwell_histogram().snapshot().total() == 6);
+};
+
+TEST_CASE("dwell sampling excludes the consume callback", "[unit]") {
+    auto q = std::make_unique<sampled_queue<int, 16, 4>>();
+
+    auto slow = [](int) { std::this_thread::sleep_for(std::chrono::milliseconds(50)); };
+    REQUIRE(q->push(0));
+    REQUIRE(q->consume_one(slow));
+    REQUIRE(q->dwell_histogram().snapshot().total() == 1);
+    REQUIRE(q->dwell_histogram().snapshot().max() < 20'000'000);
+};
+
+TEST_CASE("dwell sampling with bulk operations", "[unit]") {
+    auto q = std::make_unique<sampled_queue<std::uint32_t, 16, 4>>();
+
+    std::uint32_t in[16]{}, out[16]{};
+    REQUIRE(q->push_bulk(in, 10) == 10);  // stamps slots 0, 4, 8
+    REQUIRE(q->pop_bulk(out, 10) == 10);
+    REQUIRE(q->dwell_histogram().snapshot().total() == 3);
+
+    REQUIRE(q->push_bulk(in, 12) == 12);  // slots 10..15 and 0..5 wrap: 12, 0, 4
+    REQUIRE(q->pop_bulk(out, 12) == 12);
+    REQUIRE(q->dwell_histogram().snapshot().total() == 6);
+};
+
+TEST_CASE("dwell sampling with non-power-of-two capacity", "[unit]") {
+    auto q = std::make_unique<sampled_queue<int, 10, 4>>();
+
+    int val{};
+    for (int lap{0}; lap < 5; ++lap) {
+        for (int i{0}; i < 10; ++i)
+            REQUIRE(q->push(i));
+        for (int i{0}; i < 10; ++i)
+            REQUIRE(q->pop(val));
+    }
+    // Slots 0, 4 and 8 are sampled on every lap.
+    REQUIRE(q->dwell_histogram().snapshot().total() == 15);
+};
+
+TEST_CASE("stress dwell sampling", "[stress]") {
+    constexpr std::uint64_t N = 1'000'000;
+    auto                    q = std::make_unique<sampled_queue<std::uint64_t, 1000, 64>>();
+
+    std::thread producer([&] {
+        for (std::uint64_t i{0}; i < N; ++i)
+            while (!q->push(i))
+                std::this_thread::yield();
+    });
+
+    std::uint64_t val{}, lastTotal{0};
+    for (std::uint64_t i{0}; i < N; ++i) {
+        while (!q->pop(val))
+            std::this_thread::yield();
+        REQUIRE(val == i);
+        if (i % 65536 == 0) {
+            auto total = q->dwell_histogram().snapshot().total();
+            REQUIRE(total >= lastTotal);
+            lastTotal = total;
+        }
+    }
+    producer.join();
+
+    // Slots 0, 64, ..., 960 of 1000 are sampled: 16 per lap of 1000 items.
+    REQUIRE(q->dwell_histogram().snapshot().total() == N / 1000 * 16);
+};
@@ -0,0 +1,117 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include "event_trace.h"
+#include "spsc_queue.h"
+
+namespace {
+
+std::filesystem::path temp_file(const std::string& name) {
+    return std::filesystem::temp_directory_path()
+         / ("nsqueue_" + name + "_" + std::to_string(::getpid()) + ".json");
+}
+
+std::size_t count(std::string const& haystack, std::string const& needle) {
+    std::size_t n{0};
+    for (auto pos = haystack.find(needle); pos != std::string::npos;
+         pos      = haystack.find(needle, pos + 1))
+        ++n;
+    return n;
+}
+
+}  // namespace
+
+TEST_CASE("tsc ticks advance with wall time", "[unit]") {
+    auto t0 = nsqueue::details::tsc_now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    auto   t1 = nsqueue::details::tsc_now();
+    double ns = static_cast<double>(t1 - t0) * nsqueue::details::tsc_ns_per_tick();
+    REQUIRE(ns > 4e6);
+    REQUIRE(ns < 1e9);
+};
+
+TEST_CASE("traced_queue records stalls and batches", "[unit]") {
+    using queue = nsqueue::spsc_queue<int, 4>;
+    nsqueue::event_recorder      recorder;
+    queue                        q;
+    nsqueue::traced_queue<queue> tq(q, recorder, "orders");
+
+    int val{};
+    REQUIRE_FALSE(tq.pop(val));
+    for (int i{0}; i < 4; ++i)
+        REQUIRE(tq.push(i));
+    REQUIRE_FALSE(tq.push(4));
+    REQUIRE(tq.consume_n([](int) {}, 3) == 3);
+    REQUIRE(tq.consume_all([](int) {}) == 1);
+
+    auto& p = tq.producer_track();
+    auto& c = tq.consumer_track();
+    REQUIRE(p.name() == "orders producer");
+    REQUIRE(p.size() == 1);
+    REQUIRE(p[0].kind == nsqueue::queue_event_kind::full);
+
+    REQUIRE(c.size() == 5);
+    REQUIRE(c[0].kind == nsqueue::queue_event_kind::empty);
+    REQUIRE(c[1].kind == nsqueue::queue_event_kind::batch_begin);
+    REQUIRE(c[1].arg == 3);
+    REQUIRE(c[2].kind == nsqueue::queue_event_kind::batch_end);
+    REQUIRE(c[2].arg == 3);
+    REQUIRE(c[4].arg == 1);
+    for (std::size_t i{1}; i < c.size(); ++i)
+        REQUIRE(c[i].ticks >= c[i - 1].ticks);
+};
+
+TEST_CASE("event_track drops when full", "[unit]") {
+    nsqueue::event_recorder recorder(2);
+    auto&                   track = recorder.track("t");
+    for (int i{0}; i < 5; ++i)
+        track.record(nsqueue::queue_event_kind::full);
+    REQUIRE(track.size() == 2);
+    REQUIRE(track.dropped() == 3);
+    track.clear();
+    REQUIRE(track.size() == 0);
+    REQUIRE(track.dropped() == 0);
+};
+
+TEST_CASE("chrome trace export", "[unit]") {
+    using queue = nsqueue::spsc_queue<int, 2>;
+    nsqueue::event_recorder      recorder;
+    queue                        q;
+    nsqueue::traced_queue<queue> tq(q, recorder, "q\"1");
+
+    int val{};
+    REQUIRE_FALSE(tq.pop(val));
+    tq.force_push(1);
+    tq.force_push(2);
+    std::thread consumer([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        tq.force_pop(val);
+    });
+    tq.force_push(3);  // waits until the consumer has made room
+    consumer.join();
+    tq.consume_all([](int) {});
+
+    auto path = temp_file("chrome");
+    recorder.write_chrome_trace(path);
+    std::ifstream in(path);
+    std::string   json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::filesystem::remove(path);
+
+    REQUIRE(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0) == 0);
+    REQUIRE(json.find("\"name\":\"q\\\"1 producer\"") != std::string::npos);
+    REQUIRE(count(json, "\"ph\":\"M\"") == 2);
+    REQUIRE(count(json, "\"name\":\"wait for space\"") == 1);
+    REQUIRE(count(json, "\"name\":\"empty\"") == 1);
+    REQUIRE(count(json, "\"ph\":\"B\"") == count(json, "\"ph\":\"E\""));
+    REQUIRE(json.find("\"args\":{\"items\":2}") != std::string::npos);
+    REQUIRE(json.substr(json.size() - 4) == "\n]}\n");
+};
@@ -0,0 +1,274 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+
+#include "journal.h"
+
+namespace {
+
+struct order_event {
+    uint64_t id;
+    uint64_t qty;
+};
+
+struct temp_dir {
+    std::filesystem::path path;
+    explicit temp_dir(const std::string& name)
+        : path(std::filesystem::temp_directory_path()
+               / ("nsqueue_" + name + "_" + std::to_string(::getpid()))) {
+        std::filesystem::remove_all(path);
+    }
+    ~temp_dir() { std::filesystem::remove_all(path); }
+};
+
+// Byte ranges passed to mapped_file::sync(), by file name, while an instance is alive.
+struct msync_log {
+    static inline std::map<std::string, std::vector<std::pair<std::size_t, std::size_t>>> ranges;
+
+    msync_log() {
+        ranges.clear();
+        nsqueue::details::msync_hook = [](const std::filesystem::path& file, std::size_t offset,
+                                          std::size_t len) {
+            ranges[file.filename().string()].emplace_back(offset, offset + len);
+        };
+    }
+    ~msync_log() { nsqueue::details::msync_hook = nullptr; }
+
+    // True if the flushed ranges of `file` together cover [begin, end).
+    static bool covers(const std::string& file, std::size_t begin, std::size_t end) {
+        auto r = ranges[file];
+        std::sort(r.begin(), r.end());
+        for (auto [from, to] : r)
+            if (from <= begin && to > begin)
+                begin = to;
+        return begin >= end;
+    }
+};
+
+}  // namespace
+
+TEST_CASE("journal append/pop", "[unit]") {
+    temp_dir                          dir("journal_basic");
+    nsqueue::journal<order_event, 8>  j(dir.path);
+    REQUIRE(j.empty());
+
+    for (uint64_t i{0}; i < 20; ++i)
+        j.append({i, i * 10});
+    REQUIRE(j.size() == 20);
+    REQUIRE(std::filesystem::exists(dir.path / "0000000000000002.seg"));
+
+    order_event e{};
+    for (uint64_t i{0}; i < 20; ++i) {
+        REQUIRE(j.pop(e));
+        REQUIRE(e.id == i);
+        REQUIRE(e.qty == i * 10);
+    }
+    REQUIRE_FALSE(j.pop(e));
+    REQUIRE(j.read_position() == 20);
+};
+
+TEST_CASE("journal resumes after reopen", "[unit]") {
+    temp_dir dir("journal_reopen");
+    {
+        nsqueue::journal<order_event, 8> j(dir.path, {nsqueue::durability::none});
+        for (uint64_t i{0}; i < 12; ++i)
+            j.append({i, 0});
+        order_event e{};
+        for (int i{0}; i < 5; ++i)
+            REQUIRE(j.pop(e));
+    }
+    {
+        nsqueue::journal<order_event, 8> j(dir.path, {nsqueue::durability::none});
+        REQUIRE(j.write_position() == 12);
+        REQUIRE(j.read_position() == 5);
+
+        j.append({12, 0});
+        order_event e{};
+        for (uint64_t i{5}; i <= 12; ++i) {
+            REQUIRE(j.pop(e));
+            REQUIRE(e.id == i);
+        }
+        REQUIRE_FALSE(j.pop(e));
+
+        j.seek(2);
+        REQUIRE(j.pop(e));
+        REQUIRE(e.id == 2);
+    }
+};
+
+TEST_CASE("journal drops records past the durable position on reopen", "[unit]") {
+    temp_dir dir("journal_unsynced");
+    {
+        nsqueue::journal<order_event, 8> j(dir.path, {nsqueue::durability::batched, 4});
+        for (uint64_t i{0}; i < 4; ++i)
+            j.append({i, 0});
+        REQUIRE(j.durable_position() == 4);
+    }
+    {
+        // Stands in for a power loss: the meta page with the new write index reached the device
+        // but the records it covers did not.
+        nsqueue::journal<order_event, 8> j(dir.path, {nsqueue::durability::none});
+        for (uint64_t i{4}; i < 8; ++i)
+            j.append({i, 0});
+        order_event e{};
+        for (int i{0}; i < 6; ++i)
+            REQUIRE(j.pop(e));
+    }
+    {
+        std::fstream seg(dir.path / "0000000000000000.seg",
+                         std::ios::in | std::ios::out | std::ios::binary);
+        seg.seekp(4 * sizeof(order_event));
+        const std::string garbage(4 * sizeof(order_event), '\xa5');
+        seg.write(garbage.data(), static_cast<std::streamsize>(garbage.size()));
+    }
+    {
+        nsqueue::journal<order_event, 8> j(dir.path, {nsqueue::durability::batched, 4});
+        REQUIRE(j.write_position() == 4);
+        REQUIRE(j.read_position() == 4);
+        REQUIRE(j.durable_position() == 4);
+
+        order_event e{};
+        REQUIRE_FALSE(j.pop(e));
+        j.append({100, 0});
+        REQUIRE(j.pop(e));
+        REQUIRE(e.id == 100);
+
+        j.seek(0);
+        for (uint64_t i{0}; i < 4; ++i) {
+            REQUIRE(j.pop(e));
+            REQUIRE(e.id == i);
+        }
+    }
+};
+
+TEST_CASE("journal durability levels", "[unit]") {
+    temp_dir dir("journal_sync");
+    nsqueue::journal<order_event, 16> j(dir.path, {nsqueue::durability::batched, 4});
+
+    for (uint64_t i{0}; i < 3; ++i)
+        j.append({i, 0});
+    REQUIRE(j.durable_position() == 0);
+    j.append({3, 0});
+    REQUIRE(j.durable_position() == 4);
+
+    j.append({4, 0});
+    j.sync();
+    REQUIRE(j.durable_position() == 5);
+};
+
+TEST_CASE("journal sync flushes every segment written since the last sync", "[unit]") {
+    temp_dir                         dir("journal_sync_segments");
+    msync_log                        log;
+    nsqueue::journal<order_event, 8> j(dir.path, {nsqueue::durability::none});
+    constexpr std::size_t            seg = 8 * sizeof(order_event);
+
+    msync_log::ranges.clear();  // the new meta file
+    for (uint64_t i{0}; i < 35; ++i)
+        j.append({i, 0});
+    REQUIRE(msync_log::ranges.empty());
+    j.sync();
+    REQUIRE(j.durable_position() == 35);
+    REQUIRE(msync_log::covers("0000000000000000.seg", 0, seg));
+    REQUIRE(msync_log::covers("0000000000000001.seg", 0, seg));
+    REQUIRE(msync_log::covers("0000000000000002.seg", 0, seg));
+    REQUIRE(msync_log::covers("0000000000000003.seg", 0, seg));
+    REQUIRE(msync_log::covers("0000000000000004.seg", 0, 3 * sizeof(order_event)));
+
+    msync_log::ranges.clear();
+    for (uint64_t i{35}; i < 45; ++i)
+        j.append({i, 0});
+    j.sync();
+    REQUIRE(j.durable_position() == 45);
+    REQUIRE_FALSE(msync_log::ranges.count("0000000000000003.seg"));
+    REQUIRE(msync_log::covers("0000000000000004.seg", 3 * sizeof(order_event), seg));
+    REQUIRE_FALSE(msync_log::covers("0000000000000004.seg", 0, seg));
+    REQUIRE(msync_log::covers("0000000000000005.seg", 0, 5 * sizeof(order_event)));
+};
+
+TEST_CASE("journal reader fails on a missing segment", "[unit]") {
+    temp_dir                         dir("journal_missing");
+    nsqueue::journal<order_event, 8> j(dir.path, {nsqueue::durability::none});
+    for (uint64_t i{0}; i < 20; ++i)
+        j.append({i, 0});
+
+    std::filesystem::remove(dir.path / "0000000000000001.seg");
+    j.seek(8);
+    order_event e{};
+    REQUIRE_THROWS_AS(j.pop(e), std::system_error);
+    REQUIRE_FALSE(std::filesystem::exists(dir.path / "0000000000000001.seg"));
+};
+
+TEST_CASE("journal reclaim consumed segments", "[unit]") {
+    temp_dir                          dir("journal_reclaim");
+    nsqueue::journal<order_event, 4>  j(dir.path, {nsqueue::durability::none});
+    for (uint64_t i{0}; i < 10; ++i)
+        j.append({i, 0});
+
+    order_event e{};
+    for (int i{0}; i < 9; ++i)
+        REQUIRE(j.pop(e));
+    {
+        msync_log log;
+        static bool metaFirst;
+        metaFirst                    = false;
+        nsqueue::details::msync_hook = [](const std::filesystem::path& file, std::size_t,
+                                          std::size_t) {
+            if (file.filename() == "meta")
+                metaFirst = std::filesystem::exists(file.parent_path() / "0000000000000000.seg");
+        };
+        j.reclaim();
+        REQUIRE(metaFirst);
+    }
+
+    REQUIRE_FALSE(std::filesystem::exists(dir.path / "0000000000000000.seg"));
+    REQUIRE_FALSE(std::filesystem::exists(dir.path / "0000000000000001.seg"));
+    REQUIRE(std::filesystem::exists(dir.path / "0000000000000002.seg"));
+    REQUIRE_THROWS_AS(j.seek(0), std::out_of_range);
+
+    REQUIRE(j.pop(e));
+    REQUIRE(e.id == 9);
+};
+
+TEST_CASE("journal rejects layout mismatch", "[unit]") {
+    temp_dir dir("journal_layout");
+    { nsqueue::journal<order_event, 8> j(dir.path); }
+    REQUIRE_THROWS_AS((nsqueue::journal<uint32_t, 8>(dir.path)), std::runtime_error);
+};
+
+TEST_CASE("journal stress", "[stress]") {
+    constexpr uint64_t                     N = 200'000;
+    temp_dir                               dir("journal_stress");
+    nsqueue::journal<order_event, 4096>    j(dir.path, {nsqueue::durability::none});
+
+    std::thread producer([&] {
+        for (uint64_t i{0}; i < N; ++i)
+            j.append({i, ~i});
+    });
+
+    std::thread consumer([&] {
+        uint64_t    expected{0};
+        order_event e{};
+        while (expected < N) {
+            if (j.pop(e)) {
+                if (e.id != expected || e.qty != ~expected)
+                    FAIL("out of order");
+                ++expected;
+            }
+        }
+        REQUIRE(expected == N);
+    });
+
+    producer.join();
+    consumer.join();
+};
@@ -0,0 +1,99 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <thread>
+
+#include "lossy_queue.h"
+
+struct sample {
+    uint64_t seq;
+    uint64_t check;
+};
+
+TEST_CASE("lossy_queue push/pop", "[unit]") {
+    nsqueue::lossy_queue<int, 8> q;
+    REQUIRE(q.empty());
+
+    for (int i{1}; i <= 3; ++i)
+        q.push(i);
+    REQUIRE(q.size() == 3);
+
+    int val{};
+    for (int i{1}; i <= 3; ++i) {
+        REQUIRE(q.pop(val));
+        REQUIRE(val == i);
+    }
+    REQUIRE_FALSE(q.pop(val));
+    REQUIRE(q.dropped() == 0);
+};
+
+TEST_CASE("lossy_queue uses every slot", "[unit]") {
+    nsqueue::lossy_queue<int, 8> q;
+    for (int i{0}; i < 8; ++i)
+        q.push(i);
+
+    int val{};
+    for (int i{0}; i < 8; ++i) {
+        REQUIRE(q.pop(val));
+        REQUIRE(val == i);
+    }
+    REQUIRE(q.dropped() == 0);
+};
+
+TEST_CASE("lossy_queue overwrites oldest", "[unit]") {
+    nsqueue::lossy_queue<int, 8> q;
+    for (int i{0}; i < 20; ++i)
+        q.push(i);
+    REQUIRE(q.size() == 8);
+
+    int val{};
+    for (int i{12}; i < 20; ++i) {
+        REQUIRE(q.pop(val));
+        REQUIRE(val == i);
+    }
+    REQUIRE_FALSE(q.pop(val));
+    REQUIRE(q.dropped() == 12);
+
+    q.push(20);
+    REQUIRE(q.pop(val));
+    REQUIRE(val == 20);
+    REQUIRE(q.dropped() == 12);
+};
+
+TEST_CASE("lossy_queue stress", "[stress]") {
+    constexpr uint64_t                  N = 2'000'000;
+    nsqueue::lossy_queue<sample, 64>    q;
+
+    std::atomic<bool> done{false};
+
+    std::thread producer([&] {
+        for (uint64_t i{0}; i < N; ++i)
+            q.push({i, ~i});
+        done.store(true, std::memory_order_release);
+    });
+
+    std::thread consumer([&] {
+        uint64_t received{0};
+        uint64_t last{0};
+        sample   s{};
+        for (;;) {
+            bool finished = done.load(std::memory_order_acquire);
+            while (q.pop(s)) {
+                if (s.check != ~s.seq)
+                    FAIL("torn read");
+                if (received != 0 && s.seq <= last)
+                    FAIL("out of order");
+                last = s.seq;
+                ++received;
+            }
+            if (finished)
+                break;
+        }
+        REQUIRE(last == N - 1);
+        REQUIRE(received + q.dropped() == N);
+    });
+
+    producer.join();
+    consumer.join();
+};
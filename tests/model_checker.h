@@ -0,0 +1,700 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "detail/spin_wait.h"
+
+// A small stateless model checker for the queues' cursor protocols, after CHESS and Relacy.
+// Build the code under test with NSQUEUE_ATOMIC=nsqueue::model::atomic and hand explore() a
+// setup function that returns the threads to run. Every execution runs them as real threads,
+// one at a time, switching only at atomic operations; explore() enumerates the schedules
+// depth-first until all have been tried.
+//
+// - Orderings are tracked with vector clocks. Plain data wrapped in checked<T> is checked for
+//   data races, so a missing release or acquire shows up even though the threads never truly
+//   overlap.
+// - Loads other than seq_cst may also return an older store that the memory model allows, once
+//   per new store seen, so code that assumes a fresh value is caught as well.
+// - Schedules are preemption-bounded: at most options::preemptionBound switches away from a
+//   thread that could have continued. Most ordering bugs need one or two.
+// - A thread that keeps reading unchanged values is treated as spinning and is only run again
+//   once someone stores. If every thread is spinning the execution fails as a livelock.
+//
+// Outside explore() atomic<T> is a plain std::atomic, optionally with random delays injected
+// before each operation (see inject_delays) to shake out orderings on real hardware.
+
+namespace nsqueue::model {
+
+struct options {
+    std::size_t preemptionBound{2};
+    bool        staleReads{true};
+    std::size_t maxSteps{10'000};  // atomic operations per execution
+    std::size_t spinLimit{1'000};  // loads while every thread is spinning
+    std::size_t maxExecutions{1'000'000};
+};
+
+struct result {
+    std::size_t executions{0};
+    bool        complete{true};  // false if maxExecutions cut the search short
+    std::string failure;         // diagnosis and schedule of the first failing execution
+
+    [[nodiscard]] bool ok() const noexcept { return failure.empty(); }
+};
+
+// One execution's threads, and an optional check that runs once they have all finished.
+struct program {
+    std::vector<std::function<void()>> threads;
+    std::function<void()>              finish{};
+};
+
+using vector_clock = std::vector<std::uint32_t>;
+
+namespace details {
+
+inline void join(vector_clock& into, vector_clock const& from) {
+    if (into.size() < from.size())
+        into.resize(from.size(), 0);
+    for (std::size_t i{0}; i < from.size(); ++i)
+        into[i] = std::max(into[i], from[i]);
+}
+
+// Whether the event `thread` performed at `epoch` happens before the owner of `clock`.
+inline bool covered(vector_clock const& clock, std::size_t thread, std::uint32_t epoch) {
+    return thread < clock.size() && epoch <= clock[thread];
+}
+
+inline bool acquires(std::memory_order order) {
+    return order == std::memory_order_acquire || order == std::memory_order_consume
+        || order == std::memory_order_acq_rel || order == std::memory_order_seq_cst;
+}
+
+inline bool releases(std::memory_order order) {
+    return order == std::memory_order_release || order == std::memory_order_acq_rel
+        || order == std::memory_order_seq_cst;
+}
+
+inline const char* order_name(std::memory_order order) {
+    switch (order) {
+    case std::memory_order_relaxed:
+        return "relaxed";
+    case std::memory_order_consume:
+        return "consume";
+    case std::memory_order_acquire:
+        return "acquire";
+    case std::memory_order_release:
+        return "release";
+    case std::memory_order_acq_rel:
+        return "acq_rel";
+    default:
+        return "seq_cst";
+    }
+}
+
+template <typename T>
+std::string show(T const& v) {
+    if constexpr (std::is_same_v<T, bool>)
+        return v ? "true" : "false";
+    else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>)
+        return std::to_string(static_cast<long long>(v));
+    else
+        return "?";
+}
+
+struct thread_state {
+    vector_clock clock;
+    bool         finished{false};
+    bool         spinning{false};
+    std::size_t  unproductive{0};  // consecutive loads that saw nothing new
+};
+
+struct plain_state {
+    std::size_t   id;
+    bool          written{false};
+    std::size_t   writer{0};
+    std::uint32_t writeEpoch{0};
+    vector_clock  reads{};  // per thread, epoch of its last read since the last write
+};
+
+// Baton passed between the threads of one execution. Shared with them so that an abandoned
+// execution can leave its threads parked for good.
+struct baton {
+    std::mutex              m;
+    std::condition_variable cv;
+    std::size_t             running{0};  // 0 is the thread that called explore()
+    std::size_t             finished{0};
+    bool                    abandoned{false};
+};
+
+class scheduler;
+
+inline thread_local scheduler*  current = nullptr;
+inline thread_local std::size_t self    = 0;
+
+class scheduler {
+public:
+    explicit scheduler(options const& opt) : opt_(opt) {}
+
+    // Runs one execution, replaying recorded choices as far as they go and taking the first
+    // alternative after that.
+    template <typename Setup>
+    void run(Setup& setup) {
+        threads_.assign(1, thread_state{});
+        threads_[0].clock = {1};
+        depth_ = steps_ = idle_ = preemptions_ = nextLocation_ = 0;
+        trace_.clear();
+        plains_.clear();
+        ++execution_;
+        baton_ = std::make_shared<baton>();
+
+        current        = this;
+        self           = 0;
+        program p      = setup();
+        const auto n   = p.threads.size();
+        for (std::size_t i{1}; i <= n; ++i) {
+            thread_state t;
+            t.clock = threads_[0].clock;
+            t.clock.resize(n + 1, 0);
+            t.clock[i] = 1;
+            threads_.push_back(std::move(t));
+        }
+        ++threads_[0].clock[0];
+
+        std::vector<std::thread> workers;
+        for (std::size_t i{1}; i <= n; ++i) {
+            auto body = std::move(p.threads[i - 1]);
+            workers.emplace_back([this, b = baton_, i, body = std::move(body)]() mutable {
+                current = this;
+                self    = i;
+                {
+                    std::unique_lock lk(b->m);
+                    b->cv.wait(lk, [&] { return b->running == i; });
+                }
+                body();
+                body = nullptr;  // release captured state while still holding the baton
+                finish_thread();
+            });
+        }
+
+        auto b = baton_;
+        {
+            std::unique_lock lk(b->m);
+            b->running = n == 0 ? 0 : 1 + choose(n);
+            b->cv.notify_all();
+            b->cv.wait(lk, [&] { return b->finished == n || b->abandoned; });
+        }
+        if (b->abandoned) {
+            for (auto& w : workers)
+                w.detach();
+            current = nullptr;
+            return;
+        }
+        for (auto& w : workers)
+            w.join();
+        for (std::size_t i{1}; i <= n; ++i)
+            join(threads_[0].clock, threads_[i].clock);
+        if (p.finish)
+            p.finish();
+        choices_.resize(depth_);
+        current = nullptr;
+    }
+
+    // Moves to the next unexplored schedule. False once every schedule has been run.
+    bool next() {
+        while (!choices_.empty() && choices_.back().taken + 1 >= choices_.back().count)
+            choices_.pop_back();
+        if (choices_.empty())
+            return false;
+        ++choices_.back().taken;
+        return true;
+    }
+
+    [[nodiscard]] std::string const& failure() const noexcept { return failure_; }
+
+    // The hooks below are only ever called by the thread holding the baton.
+
+    [[nodiscard]] std::uint64_t execution() const noexcept { return execution_; }
+    [[nodiscard]] std::size_t   threads() const noexcept { return threads_.size(); }
+    [[nodiscard]] bool          stale_reads() const noexcept { return opt_.staleReads; }
+    [[nodiscard]] std::size_t   new_location() noexcept { return nextLocation_++; }
+    [[nodiscard]] vector_clock& clock(std::size_t t) noexcept { return threads_[t].clock; }
+    [[nodiscard]] bool spinning(std::size_t t) const noexcept { return threads_[t].spinning; }
+
+    // Picks one of n alternatives for the current choice point.
+    std::size_t choose(std::size_t n) {
+        if (n <= 1)
+            return 0;
+        if (depth_ < choices_.size()) {
+            auto& c = choices_[depth_++];
+            if (c.count != n)
+                fail("the program under test is not deterministic");
+            return std::min(c.taken, n - 1);
+        }
+        choices_.push_back({n, 0});
+        ++depth_;
+        return 0;
+    }
+
+    // Scheduling point before every atomic operation of a model thread.
+    void before_atomic() {
+        if (self == 0)
+            return;
+        if (++steps_ > opt_.maxSteps)
+            abandon("step limit of " + std::to_string(opt_.maxSteps) + " exceeded");
+        auto next = pick(true);
+        if (next != self)
+            switch_to(next);
+    }
+
+    // Advances the thread's own clock component after an atomic operation, so that plain
+    // accesses after a release are not covered by it.
+    void after_atomic(std::size_t t) { ++threads_[t].clock[t]; }
+
+    void note_load(std::size_t t, bool repeat) {
+        if (t == 0)
+            return;
+        auto& th = threads_[t];
+        if (!repeat) {
+            th.unproductive = 0;
+            th.spinning     = false;
+            return;
+        }
+        if (++th.unproductive >= 2)
+            th.spinning = true;
+        if (th.spinning && active() == 0 && ++idle_ > opt_.spinLimit)
+            abandon("livelock: every thread is waiting for a store that never comes");
+    }
+
+    void note_store() {
+        for (auto& th : threads_) {
+            th.spinning     = false;
+            th.unproductive = 0;
+        }
+        idle_ = 0;
+    }
+
+    void plain_access(const void* p, bool write) {
+        auto  t     = self;
+        auto& clock = threads_[t].clock;
+        auto [it, inserted] = plains_.try_emplace(p, plain_state{plains_.size()});
+        auto& st            = it->second;
+        if (st.written && st.writer != t && !covered(clock, st.writer, st.writeEpoch))
+            race(st, write ? "write" : "read", "write", st.writer);
+        if (write) {
+            for (std::size_t u{0}; u < st.reads.size(); ++u)
+                if (u != t && st.reads[u] != 0 && !covered(clock, u, st.reads[u]))
+                    race(st, "write", "read", u);
+            st.written    = true;
+            st.writer     = t;
+            st.writeEpoch = clock[t];
+            st.reads.clear();
+        } else {
+            if (st.reads.size() <= t)
+                st.reads.resize(t + 1, 0);
+            st.reads[t] = clock[t];
+        }
+    }
+
+    void trace(std::string line) {
+        trace_.push_back((self == 0 ? std::string("setup ") : "t" + std::to_string(self) + "    ")
+                         + line);
+    }
+
+    void fail(std::string const& what) {
+        if (!failure_.empty())
+            return;
+        failure_ = what + "\nschedule:";
+        const std::size_t from = trace_.size() > 60 ? trace_.size() - 60 : 0;
+        if (from > 0)
+            failure_ += "\n  ... " + std::to_string(from) + " earlier steps";
+        for (std::size_t i = from; i < trace_.size(); ++i)
+            failure_ += "\n  " + trace_[i];
+    }
+
+private:
+    struct choice {
+        std::size_t count;
+        std::size_t taken;
+    };
+
+    [[nodiscard]] std::size_t active() const noexcept {
+        std::size_t n{0};
+        for (std::size_t i{1}; i < threads_.size(); ++i)
+            n += !threads_[i].finished && !threads_[i].spinning;
+        return n;
+    }
+
+    // Chooses who runs next. Spinning threads only get a turn when nobody else can run.
+    std::size_t pick(bool selfRunnable) {
+        std::vector<std::size_t> pool;
+        const bool               anyActive = active() > 0;
+        for (std::size_t i{1}; i < threads_.size(); ++i)
+            if (!threads_[i].finished && (!anyActive || !threads_[i].spinning))
+                pool.push_back(i);
+
+        const bool selfIn = selfRunnable && std::find(pool.begin(), pool.end(), self) != pool.end();
+        std::vector<std::size_t> alternatives;
+        if (selfIn) {
+            alternatives.push_back(self);
+            if (preemptions_ < opt_.preemptionBound)
+                for (auto i : pool)
+                    if (i != self)
+                        alternatives.push_back(i);
+        } else {
+            alternatives = pool;
+        }
+        auto c = choose(alternatives.size());
+        if (selfIn && c != 0)
+            ++preemptions_;
+        return alternatives[c];
+    }
+
+    void switch_to(std::size_t next) {
+        auto&            b = *baton_;
+        std::unique_lock lk(b.m);
+        b.running = next;
+        b.cv.notify_all();
+        const auto me = self;
+        b.cv.wait(lk, [&] { return b.running == me; });
+    }
+
+    void finish_thread() {
+        threads_[self].finished = true;
+        std::size_t next{0};
+        if (std::any_of(threads_.begin() + 1, threads_.end(),
+                        [](auto const& t) { return !t.finished; }))
+            next = pick(false);
+        auto&            b = *baton_;
+        std::unique_lock lk(b.m);
+        ++b.finished;
+        b.running = next;
+        b.cv.notify_all();
+    }
+
+    // Gives up on an execution that cannot finish. The calling thread and any others stay
+    // parked; explore() reports the failure and stops.
+    [[noreturn]] void abandon(std::string const& what) {
+        fail(what);
+        auto             b = baton_;
+        std::unique_lock lk(b->m);
+        b->abandoned = true;
+        b->running   = static_cast<std::size_t>(-1);
+        b->cv.notify_all();
+        for (;;)
+            b->cv.wait(lk);
+    }
+
+    void race(plain_state const& st, const char* access, const char* earlier, std::size_t other) {
+        fail("data race on plain location #" + std::to_string(st.id) + ": " + access + " by "
+             + (self == 0 ? std::string("setup") : "t" + std::to_string(self))
+             + " is not ordered after the " + earlier + " by "
+             + (other == 0 ? std::string("setup") : "t" + std::to_string(other)));
+    }
+
+    options                                         opt_;
+    std::vector<choice>                             choices_;
+    std::vector<thread_state>                       threads_;
+    std::unordered_map<const void*, plain_state>    plains_;
+    std::vector<std::string>                        trace_;
+    std::string                                     failure_;
+    std::shared_ptr<baton>                          baton_;
+    std::uint64_t                                   execution_{0};
+    std::size_t depth_{0}, steps_{0}, idle_{0}, preemptions_{0}, nextLocation_{0};
+};
+
+struct delay_config {
+    double   probability{0};
+    unsigned maxSpins{1};
+};
+
+inline delay_config delays;
+
+inline void maybe_delay() {
+    if (delays.probability <= 0)
+        return;
+    thread_local std::minstd_rand rng(
+        static_cast<unsigned>(std::hash<std::thread::id>{}(std::this_thread::get_id())));
+    if (std::uniform_real_distribution<double>(0, 1)(rng) >= delays.probability)
+        return;
+    auto spins = rng() % delays.maxSpins;
+    if (spins % 8 == 0) {
+        std::this_thread::yield();
+        return;
+    }
+    for (; spins > 0; --spins)
+        nsqueue::details::cpu_relax();
+}
+
+}  // namespace details
+
+// Injects a random pause before a fraction of atomic<T> operations made outside explore(),
+// for as long as it is in scope. Not thread-safe: create it before starting the threads.
+class inject_delays {
+public:
+    explicit inject_delays(double probability, unsigned maxSpins = 1000) {
+        details::delays = {probability, std::max(maxSpins, 1u)};
+    }
+    inject_delays(inject_delays const&)            = delete;
+    inject_delays& operator=(inject_delays const&) = delete;
+    ~inject_delays() { details::delays = {}; }
+};
+
+// Drop-in for std::atomic<T> with the subset of its interface the queues use.
+template <typename T>
+class atomic {
+public:
+    atomic() noexcept : atomic(T{}) {}
+    atomic(T v) noexcept : real_(v) {}  // NOLINT: mirrors std::atomic's converting constructor
+    atomic(atomic const&)            = delete;
+    atomic& operator=(atomic const&) = delete;
+
+    T load(std::memory_order order = std::memory_order_seq_cst) const noexcept {
+        auto* s = details::current;
+        if (s == nullptr) {
+            details::maybe_delay();
+            return real_.load(order);
+        }
+        s->before_atomic();
+        return const_cast<atomic*>(this)->model_load(*s, order);
+    }
+
+    void store(T v, std::memory_order order = std::memory_order_seq_cst) noexcept {
+        auto* s = details::current;
+        if (s == nullptr) {
+            details::maybe_delay();
+            real_.store(v, order);
+            return;
+        }
+        s->before_atomic();
+        model_store(*s, v, order, "store", {});
+    }
+
+    T exchange(T v, std::memory_order order = std::memory_order_seq_cst) noexcept {
+        return read_modify_write([&](T) { return v; }, order, "exchange",
+                                 [&] { return real_.exchange(v, order); });
+    }
+
+    T fetch_add(T v, std::memory_order order = std::memory_order_seq_cst) noexcept {
+        return read_modify_write([&](T old) { return static_cast<T>(old + v); }, order,
+                                 "fetch_add", [&] { return real_.fetch_add(v, order); });
+    }
+
+    T fetch_sub(T v, std::memory_order order = std::memory_order_seq_cst) noexcept {
+        return read_modify_write([&](T old) { return static_cast<T>(old - v); }, order,
+                                 "fetch_sub", [&] { return real_.fetch_sub(v, order); });
+    }
+
+    bool compare_exchange_strong(T& expected, T desired, std::memory_order success,
+                                 std::memory_order failure) noexcept {
+        auto* s = details::current;
+        if (s == nullptr) {
+            details::maybe_delay();
+            return real_.compare_exchange_strong(expected, desired, success, failure);
+        }
+        s->before_atomic();
+        sync_execution(*s);
+        if (history_.back().value == expected) {
+            auto prev = history_.back();
+            acquire(*s, prev, success);
+            model_store(*s, desired, success, "cas", prev.sync, true);
+            return true;
+        }
+        expected = model_load(*s, failure, true);
+        return false;
+    }
+
+    bool compare_exchange_strong(T& expected, T desired,
+                                 std::memory_order order = std::memory_order_seq_cst) noexcept {
+        auto failure = order == std::memory_order_acq_rel ? std::memory_order_acquire
+                     : order == std::memory_order_release ? std::memory_order_relaxed
+                                                          : order;
+        return compare_exchange_strong(expected, desired, order, failure);
+    }
+
+    // Never fails spuriously under the model.
+    template <typename... Orders>
+    bool compare_exchange_weak(T& expected, T desired, Orders... orders) noexcept {
+        return compare_exchange_strong(expected, desired, orders...);
+    }
+
+    operator T() const noexcept { return load(); }  // NOLINT: as std::atomic
+
+private:
+    struct store_record {
+        T                     value;
+        std::size_t           thread;
+        std::uint32_t         epoch;
+        model::vector_clock   sync;  // what an acquiring load of this store synchronizes with
+    };
+
+    // Starts a fresh modification order for each execution, seeded with the current value.
+    void sync_execution(details::scheduler& s) {
+        if (execution_ == s.execution())
+            return;
+        execution_ = s.execution();
+        id_        = s.new_location();
+        history_.assign(1, store_record{real_.load(std::memory_order_relaxed), 0, 0, {}});
+        seen_.clear();
+        seenSize_.clear();
+        lastRead_.clear();
+    }
+
+    // Per-thread state grows on first use, since setup may touch the atomic before the
+    // threads exist.
+    void track(std::size_t t) {
+        if (seen_.size() > t)
+            return;
+        seen_.resize(t + 1, 0);
+        seenSize_.resize(t + 1, 0);
+        lastRead_.resize(t + 1, static_cast<std::size_t>(-1));
+    }
+
+    void acquire(details::scheduler& s, store_record const& r, std::memory_order order) {
+        if (details::acquires(order))
+            details::join(s.clock(details::self), r.sync);
+    }
+
+    T model_load(details::scheduler& s, std::memory_order order, bool forceLatest = false) {
+        sync_execution(s);
+        const auto t = details::self;
+        const auto n = history_.size();
+        track(t);
+        auto&      clock = s.clock(t);
+
+        // Coherence: nothing older than what this thread has seen or what happens before it.
+        std::size_t lower = seen_[t];
+        for (std::size_t j = n - 1; j > lower; --j) {
+            if (details::covered(clock, history_[j].thread, history_[j].epoch)) {
+                lower = j;
+                break;
+            }
+        }
+        const bool  fresh = seenSize_[t] != n;
+        std::size_t idx   = n - 1;
+        if (fresh && !forceLatest && s.stale_reads() && order != std::memory_order_seq_cst
+            && !s.spinning(t) && lower < n - 1)
+            idx = n - 1 - s.choose(n - lower);
+
+        s.note_load(t, !fresh && idx == n - 1 && lastRead_[t] == idx);
+        seen_[t]     = idx;
+        seenSize_[t] = n;
+        lastRead_[t] = idx;
+        acquire(s, history_[idx], order);
+        s.trace(std::string("load     ") + details::order_name(order) + " #" + std::to_string(id_)
+                + " -> " + details::show(history_[idx].value)
+                + (idx + 1 < n ? " (stale)" : ""));
+        s.after_atomic(t);
+        return history_[idx].value;
+    }
+
+    void model_store(details::scheduler& s, T v, std::memory_order order, const char* what,
+                     model::vector_clock const& carried, bool traced = false) {
+        sync_execution(s);
+        const auto t    = details::self;
+        track(t);
+        auto       sync = details::releases(order) ? s.clock(t) : model::vector_clock{};
+        details::join(sync, carried);  // read-modify-writes continue a release sequence
+        history_.push_back(store_record{v, t, s.clock(t)[t], std::move(sync)});
+        seen_[t] = history_.size() - 1;
+        real_.store(v, std::memory_order_relaxed);
+        s.note_store();
+        s.trace(std::string(what) + (traced ? "      " : "    ") + details::order_name(order) + " #"
+                + std::to_string(id_) + " <- " + details::show(v));
+        s.after_atomic(t);
+    }
+
+    template <typename F, typename Real>
+    T read_modify_write(F f, std::memory_order order, const char* what, Real real) {
+        auto* s = details::current;
+        if (s == nullptr) {
+            details::maybe_delay();
+            return real();
+        }
+        s->before_atomic();
+        sync_execution(*s);
+        auto prev = history_.back();
+        acquire(*s, prev, order);
+        model_store(*s, f(prev.value), order, what, prev.sync, true);
+        return prev.value;
+    }
+
+    std::atomic<T>            real_;
+    std::vector<store_record> history_;
+    std::vector<std::size_t>  seen_;      // per thread: oldest store it may still read
+    std::vector<std::size_t>  seenSize_;  // per thread: history size at its last load
+    std::vector<std::size_t>  lastRead_;  // per thread: store its last load returned
+    std::uint64_t             execution_{0};
+    std::size_t               id_{0};
+};
+
+// A plain value whose reads and writes are checked for data races under explore(). Use it as
+// the element type of the queue under test.
+template <typename T>
+class checked {
+public:
+    checked() noexcept { touch(true); }
+    checked(T v) noexcept : value_(v) { touch(true); }  // NOLINT: implicit, like T
+    checked(checked const& other) noexcept : value_(other.get()) { touch(true); }
+    checked& operator=(checked const& other) noexcept {
+        value_ = other.get();
+        touch(true);
+        return *this;
+    }
+
+    [[nodiscard]] T get() const noexcept {
+        touch(false);
+        return value_;
+    }
+
+private:
+    void touch(bool write) const {
+        if (auto* s = details::current)
+            s->plain_access(this, write);
+    }
+
+    T value_{};
+};
+
+// Fails the current execution with `what` unless `ok`. Only meaningful under explore().
+inline void check(bool ok, std::string const& what) {
+    if (!ok && details::current != nullptr)
+        details::current->fail(what);
+}
+
+// Runs setup() and the threads it returns under every schedule within the bounds, stopping at
+// the first failure.
+template <typename Setup>
+result explore(options const& opt, Setup setup) {
+    details::scheduler s(opt);
+    result             r;
+    for (;;) {
+        ++r.executions;
+        s.run(setup);
+        if (!s.failure().empty()) {
+            r.failure = s.failure() + "\n(execution " + std::to_string(r.executions) + ")";
+            return r;
+        }
+        if (!s.next())
+            break;
+        if (r.executions >= opt.maxExecutions) {
+            r.complete = false;
+            break;
+        }
+    }
+    return r;
+}
+
+}  // namespace nsqueue::model
@@ -0,0 +1,83 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <thread>
+
+#include "recycling_channel.h"
+
+struct message {
+    uint64_t seq{};
+    char     payload[56]{};
+};
+
+TEST_CASE("object_pool acquire/release", "[unit]") {
+    nsqueue::object_pool<message, 4> pool;
+    REQUIRE(pool.available() == 4);
+
+    message* objs[4];
+    for (auto& obj : objs) {
+        obj = pool.acquire();
+        REQUIRE(obj != nullptr);
+        REQUIRE(pool.owns(obj));
+    }
+    REQUIRE(pool.acquire() == nullptr);
+
+    pool.release(objs[2]);
+    REQUIRE(pool.acquire() == objs[2]);
+
+    message outside;
+    REQUIRE_FALSE(pool.owns(&outside));
+};
+
+TEST_CASE("recycling_channel round trip", "[unit]") {
+    nsqueue::recycling_channel<message, 4> ch;
+    REQUIRE(ch.empty());
+
+    for (uint64_t i{0}; i < 4; ++i)
+        REQUIRE(ch.produce([i](message& m) { m.seq = i; }));
+    REQUIRE_FALSE(ch.produce([](message&) {}));
+    REQUIRE(ch.size() == 4);
+
+    message* m = ch.receive();
+    REQUIRE(m != nullptr);
+    REQUIRE(m->seq == 0);
+    ch.release(m);
+
+    // The released buffer is recycled once the pool runs dry.
+    message* again = ch.acquire();
+    REQUIRE(again == m);
+    ch.send(again);
+
+    uint64_t n = ch.consume_all([](message&) {});
+    REQUIRE(n == 4);
+    REQUIRE(ch.empty());
+};
+
+TEST_CASE("recycling_channel stress", "[stress]") {
+    constexpr uint64_t                        N = 500'000;
+    nsqueue::recycling_channel<message, 64>   ch;
+
+    std::thread producer([&] {
+        for (uint64_t i{0}; i < N; ++i) {
+            while (!ch.produce([i](message& m) { m.seq = i; }))
+                continue;
+        }
+    });
+
+    std::thread consumer([&] {
+        uint64_t expected{0};
+        while (expected < N) {
+            ch.consume_one([&](message& m) {
+                if (!ch.owns(&m))
+                    FAIL("foreign buffer");
+                if (m.seq != expected)
+                    FAIL("out of order");
+                ++expected;
+            });
+        }
+        REQUIRE(expected == N);
+    });
+
+    producer.join();
+    consumer.join();
+};
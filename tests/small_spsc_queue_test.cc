@@ -0,0 +1,92 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "small_spsc_queue.h"
+
+using nsqueue::queue_layout;
+
+TEST_CASE("small_spsc_queue push/pop", "[unit]") {
+    nsqueue::small_spsc_queue<int, 8> q;
+    REQUIRE(q.empty());
+    REQUIRE(q.capacity() == 8);
+
+    for (int i{1}; i <= 8; ++i)
+        REQUIRE(q.emplace(i));
+    REQUIRE(q.full());
+    REQUIRE(q.size() == 8);
+    REQUIRE_FALSE(q.push(9));
+
+    int val{};
+    for (int i{1}; i <= 8; ++i) {
+        REQUIRE(q.pop(val));
+        REQUIRE(val == i);
+    }
+    REQUIRE(q.empty());
+    REQUIRE_FALSE(q.pop(val));
+};
+
+TEST_CASE("small_spsc_queue cursor wrap", "[unit]") {
+    // 16-bit cursors wrap many times over; size() must stay exact across the wrap.
+    nsqueue::small_spsc_queue<uint32_t, 16, queue_layout::shared_line> q;
+    static_assert(sizeof(decltype(q)::cursor_t) == 2);
+
+    uint32_t next{0}, expected{0}, val{};
+    for (int round{0}; round < 20'000; ++round) {
+        for (int i{0}; i < 11; ++i)
+            REQUIRE(q.push(next++));
+        REQUIRE(q.size() == 11);
+        REQUIRE(q.consume_all([&](uint32_t v) { REQUIRE(v == expected++); }) == 11);
+    }
+    REQUIRE(next > 3 * 65'536);
+    REQUIRE_FALSE(q.pop(val));
+};
+
+TEST_CASE("small_spsc_queue footprint", "[unit]") {
+    using packed = nsqueue::small_spsc_queue<uint32_t, 16, queue_layout::shared_line>;
+    REQUIRE(sizeof(packed) == 4 * sizeof(uint16_t) + 16 * sizeof(uint32_t));
+
+    // The slots follow the two padded cursor blocks and are padded out to the same alignment.
+    using split       = nsqueue::small_spsc_queue<uint32_t, 16>;
+    constexpr auto fs = nsqueue::details::falseSharingSize;
+    REQUIRE(sizeof(split) == 2 * fs + (16 * sizeof(uint32_t) + fs - 1) / fs * fs);
+};
+
+TEST_CASE("small_spsc_queue move-only type", "[unit]") {
+    nsqueue::small_spsc_queue<std::unique_ptr<int>, 4> q;
+    REQUIRE(q.emplace(std::make_unique<int>(7)));
+    std::unique_ptr<int> p;
+    REQUIRE(q.pop(p));
+    REQUIRE(*p == 7);
+};
+
+template <queue_layout Layout>
+void small_queue_stress() {
+    constexpr uint32_t                              N = 300'000;
+    nsqueue::small_spsc_queue<uint32_t, 16, Layout> q;
+
+    std::thread producer([&] {
+        for (uint32_t i{0}; i < N; ++i)
+            while (!q.push(i))
+                std::this_thread::yield();
+    });
+
+    uint32_t val{};
+    for (uint32_t i{0}; i < N; ++i) {
+        while (!q.pop(val))
+            std::this_thread::yield();
+        if (val != i)
+            FAIL("out of order");
+    }
+    producer.join();
+    REQUIRE(q.empty());
+}
+
+TEST_CASE("small_spsc_queue stress", "[stress]") {
+    small_queue_stress<queue_layout::split>();
+    small_queue_stress<queue_layout::shared_line>();
+};
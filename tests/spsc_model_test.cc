@@ -0,0 +1,246 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "model_checker.h"
+#include "small_spsc_queue.h"
+#include "spsc_queue.h"
+
+// Built with NSQUEUE_ATOMIC=nsqueue::model::atomic, so the queues' cursors below run under the
+// checker. Each test explores every schedule of a producer and a consumer within the default
+// bounds; a failure prints the offending schedule.
+
+namespace model = nsqueue::model;
+
+namespace {
+
+void require_ok(model::result const& r) {
+    INFO(r.failure);
+    REQUIRE(r.ok());
+    REQUIRE(r.complete);
+}
+
+struct message {
+    model::checked<int> data;
+    model::atomic<bool> ready{false};
+};
+
+model::result publish(std::memory_order store, std::memory_order load) {
+    return model::explore({}, [=] {
+        auto m = std::make_shared<message>();
+        return model::program{{[=] {
+                                   m->data = 42;
+                                   m->ready.store(true, store);
+                               },
+                               [=] {
+                                   while (!m->ready.load(load))
+                                       continue;
+                                   model::check(m->data.get() == 42, "consumer saw stale data");
+                               }}};
+    });
+}
+
+struct flags {
+    model::atomic<int> x{0};
+    model::atomic<int> flag{0};
+};
+
+model::result message_passing(std::memory_order store, std::memory_order load) {
+    return model::explore({}, [=] {
+        auto f = std::make_shared<flags>();
+        return model::program{{[=] {
+                                   f->x.store(1, std::memory_order_relaxed);
+                                   f->flag.store(1, store);
+                               },
+                               [=] {
+                                   if (f->flag.load(load) == 1)
+                                       model::check(f->x.load(std::memory_order_relaxed) == 1,
+                                                    "flag seen before x");
+                               }}};
+    });
+}
+
+// Producer pushes 0..items-1, retrying while full; consumer pops them, retrying while empty.
+template <typename Queue>
+model::result transfer(int items) {
+    return model::explore({}, [=] {
+        auto q = std::make_shared<Queue>();
+        return model::program{{[=] {
+                                   for (int i{0}; i < items; ++i)
+                                       while (!q->push(i))
+                                           continue;
+                               },
+                               [=] {
+                                   typename Queue::value_type v;
+                                   for (int i{0}; i < items; ++i) {
+                                       while (!q->pop(v))
+                                           continue;
+                                       model::check(v.get() == i, "items out of order");
+                                   }
+                               }},
+                              [=] { model::check(q->empty(), "queue not drained"); }};
+    });
+}
+
+template <typename T, std::size_t N>
+struct checked_queue : nsqueue::spsc_queue<T, N> {
+    using value_type = T;
+};
+
+template <typename T, std::size_t N>
+struct checked_small_queue : nsqueue::small_spsc_queue<T, N> {
+    using value_type = T;
+};
+
+}  // namespace
+
+TEST_CASE("model checker flags a relaxed publish", "[model]") {
+    auto relaxed = publish(std::memory_order_relaxed, std::memory_order_acquire);
+    REQUIRE_FALSE(relaxed.ok());
+    REQUIRE(relaxed.failure.find("data race") != std::string::npos);
+
+    auto unacquired = publish(std::memory_order_release, std::memory_order_relaxed);
+    REQUIRE_FALSE(unacquired.ok());
+
+    require_ok(publish(std::memory_order_release, std::memory_order_acquire));
+};
+
+TEST_CASE("model checker explores stale reads", "[model]") {
+    auto relaxed = message_passing(std::memory_order_relaxed, std::memory_order_relaxed);
+    REQUIRE_FALSE(relaxed.ok());
+    REQUIRE(relaxed.failure.find("flag seen before x") != std::string::npos);
+
+    require_ok(message_passing(std::memory_order_release, std::memory_order_acquire));
+};
+
+TEST_CASE("model checker reports livelock", "[model]") {
+    auto r = model::explore({}, [] {
+        auto flag = std::make_shared<model::atomic<bool>>(false);
+        return model::program{{[=] {
+            while (!flag->load(std::memory_order_acquire))
+                continue;
+        }}};
+    });
+    REQUIRE_FALSE(r.ok());
+    REQUIRE(r.failure.find("livelock") != std::string::npos);
+};
+
+TEST_CASE("spsc_queue push/pop under the model", "[model]") {
+    require_ok(transfer<checked_queue<model::checked<int>, 2>>(3));
+    require_ok(transfer<checked_queue<model::checked<int>, 3>>(4));  // non power of two
+};
+
+TEST_CASE("spsc_queue force_push/force_pop under the model", "[model]") {
+    require_ok(model::explore({}, [] {
+        auto q = std::make_shared<nsqueue::spsc_queue<model::checked<int>, 2>>();
+        return model::program{{[=] {
+                                   for (int i{0}; i < 3; ++i)
+                                       q->force_push(i);
+                               },
+                               [=] {
+                                   model::checked<int> v;
+                                   for (int i{0}; i < 3; ++i) {
+                                       q->force_pop(v);
+                                       model::check(v.get() == i, "items out of order");
+                                   }
+                               }}};
+    }));
+};
+
+TEST_CASE("spsc_queue consume_one/consume_all under the model", "[model]") {
+    require_ok(model::explore({}, [] {
+        auto q = std::make_shared<nsqueue::spsc_queue<model::checked<int>, 2>>();
+        return model::program{{[=] {
+                                   for (int i{0}; i < 3; ++i)
+                                       while (!q->push(i))
+                                           continue;
+                               },
+                               [=] {
+                                   int next{0};
+                                   auto check = [&](model::checked<int> const& v) {
+                                       model::check(v.get() == next++, "items out of order");
+                                   };
+                                   while (next < 2)
+                                       q->consume_one(check);
+                                   while (next < 3)
+                                       q->consume_all(check);
+                               }}};
+    }));
+};
+
+TEST_CASE("spsc_queue push_bulk/pop_bulk under the model", "[model]") {
+    // Bulk transfers need trivially copyable items, so only ordering and coherence of the
+    // cursors are checked here, not the slot contents.
+    require_ok(model::explore({}, [] {
+        auto q = std::make_shared<nsqueue::spsc_queue<int, 4>>();
+        return model::program{{[=] {
+                                   const int items[]{0, 1, 2, 3, 4, 5};
+                                   for (std::size_t sent{0}; sent < 6;)
+                                       sent += q->push_bulk(items + sent, 6 - sent);
+                               },
+                               [=] {
+                                   int out[6]{};
+                                   for (std::size_t got{0}; got < 6;)
+                                       got += q->pop_bulk(out + got, 6 - got);
+                                   for (int i{0}; i < 6; ++i)
+                                       model::check(out[i] == i, "items out of order");
+                               }}};
+    }));
+};
+
+TEST_CASE("small_spsc_queue push/pop under the model", "[model]") {
+    require_ok(transfer<checked_small_queue<model::checked<int>, 2>>(3));
+};
+
+TEST_CASE("small_spsc_queue force_push/force_pop under the model", "[model]") {
+    require_ok(model::explore({}, [] {
+        auto q = std::make_shared<nsqueue::small_spsc_queue<model::checked<int>, 2>>();
+        return model::program{{[=] {
+                                   for (int i{0}; i < 3; ++i)
+                                       q->force_push(i);
+                               },
+                               [=] {
+                                   model::checked<int> v;
+                                   for (int i{0}; i < 3; ++i) {
+                                       q->force_pop(v);
+                                       model::check(v.get() == i, "items out of order");
+                                   }
+                               }}};
+    }));
+};
+
+TEST_CASE("spsc_queue with injected delays", "[model]") {
+    // Outside explore() the cursors are real atomics; random pauses before their operations
+    // push the threads through interleavings a tight loop rarely hits.
+    model::inject_delays delays(0.05, 2000);
+
+    constexpr uint64_t ITEMS = 100'000;
+    auto               q     = std::make_unique<nsqueue::spsc_queue<uint64_t, 16>>();
+    auto               s     = std::make_unique<nsqueue::small_spsc_queue<uint64_t, 8>>();
+    bool               ordered{true};
+
+    std::thread consumer([&] {
+        uint64_t v{};
+        for (uint64_t i{0}; i < ITEMS; ++i) {
+            if (i % 2 == 0)
+                q->force_pop(v);
+            else
+                s->force_pop(v);
+            ordered &= v == i;
+        }
+    });
+    for (uint64_t i{0}; i < ITEMS; ++i) {
+        if (i % 2 == 0)
+            q->force_push(i);
+        else
+            s->force_push(i);
+    }
+    consumer.join();
+
+    REQUIRE(ordered);
+    REQUIRE(q->empty());
+    REQUIRE(s->empty());
+};
@@ -4,6 +4,8 @@
 #include <thread>
 #include <atomic>
 #include <vector>
+#include <cstring>
+#include <memory_resource>
 
 #include "spsc_queue.h"
 
@@ -62,11 +64,13 @@ TEST_CASE("consume_all","[unit]"){
 
 TEST_CASE("fail on full queue", "[unit]"){
     nsqueue::spsc_queue<int, 8> q;
-    for(int i{1}; i<= 7; ++i)
+    for(int i{1}; i<= 8; ++i)
         REQUIRE(q.emplace(i));
     
     REQUIRE(q.full());
-    REQUIRE_FALSE(q.emplace(8));
+    REQUIRE(q.size() == 8);
+    REQUIRE(q.capacity() == 8);
+    REQUIRE_FALSE(q.emplace(9));
 };
 
 TEST_CASE("reset", "[unit]"){
@@ -98,21 +102,37 @@ TEST_CASE("move-only type", "[unit]"){
 TEST_CASE("wrap around", "[unit]"){
     nsqueue::spsc_queue<int, 4> q;
     
-    for(int i{1}; i<= 3;++i)
+    for(int i{1}; i<= 4;++i)
         REQUIRE(q.emplace(i));
-    REQUIRE_FALSE(q.emplace(4));
+    REQUIRE_FALSE(q.emplace(5));
     
     int val{};
     REQUIRE(q.pop(val)); REQUIRE(val == 1);
-    REQUIRE(q.emplace(4));
+    REQUIRE(q.emplace(5));
 
-    for(int i{2}; i<=4; ++i){
+    for(int i{2}; i<=5; ++i){
         REQUIRE(q.pop(val)); REQUIRE(val == i);
     }
 
     REQUIRE(q.empty());
 };
 
+TEST_CASE("size across many laps", "[unit]"){
+    nsqueue::spsc_queue<int, 4> q;
+    int val{};
+    for(int lap{0}; lap < 1000; ++lap){
+        REQUIRE(q.emplace(lap));
+        REQUIRE(q.emplace(lap));
+        REQUIRE(q.emplace(lap));
+        REQUIRE(q.size() == 3);
+        REQUIRE(q.front() == lap);
+        for(int i{0}; i < 3; ++i){
+            REQUIRE(q.pop(val)); REQUIRE(val == lap);
+        }
+        REQUIRE(q.size() == 0);
+    }
+};
+
 TEST_CASE("stress", "[stress]"){
     constexpr int N = 200'000;
     nsqueue::spsc_queue<int,1024> q;
@@ -141,3 +161,201 @@ TEST_CASE("stress", "[stress]"){
     producer.join();
     consumer.join();
 };
+
+TEST_CASE("non-power-of-two capacity", "[unit]"){
+    nsqueue::spsc_queue<int, 3> q;
+    REQUIRE(q.capacity() == 3);
+    for(int i{1}; i <= 3; ++i)
+        REQUIRE(q.emplace(i));
+    REQUIRE(q.full());
+    REQUIRE_FALSE(q.emplace(4));
+
+    // Varying fill levels walk the cursors across every point of their [0, 2N) range.
+    int next{4}, expected{1}, val{};
+    for(int lap{0}; lap < 1000; ++lap){
+        for(int i{0}; i < lap % 3 + 1; ++i){
+            REQUIRE(q.pop(val)); REQUIRE(val == expected++);
+        }
+        while(q.emplace(next))
+            ++next;
+        REQUIRE(q.size() == 3);
+    }
+    REQUIRE(q.consume_all([&](int v){ REQUIRE(v == expected++); }) == 3);
+    REQUIRE(q.empty());
+};
+
+TEST_CASE("non-power-of-two bulk", "[unit]"){
+    nsqueue::spsc_queue<uint64_t, 5> q;
+    uint64_t in[7], out[7];
+    uint64_t next{0}, expected{0};
+    for(int round{0}; round < 200; ++round){
+        const auto want = static_cast<std::size_t>(round % 7 + 1);
+        for(std::size_t i{0}; i < want; ++i)
+            in[i] = next + i;
+        next += q.push_bulk(in, want);
+        REQUIRE(q.size() <= 5);
+        const auto got = q.pop_bulk(out, static_cast<std::size_t>(round % 4 + 1));
+        for(std::size_t i{0}; i < got; ++i)
+            REQUIRE(out[i] == expected++);
+    }
+    while(q.pop_bulk(out, 1) == 1)
+        REQUIRE(out[0] == expected++);
+    REQUIRE(expected == next);
+};
+
+TEST_CASE("stress non-power-of-two", "[stress]"){
+    constexpr int N = 200'000;
+    nsqueue::spsc_queue<int, 1000> q;
+
+    std::thread producer([&] {
+        for(int i{0}; i<N; ++i){
+            while(!q.emplace(i)) { continue; }
+        }
+    });
+
+    int val{};
+    for(int i{0}; i<N; ++i){
+        while(!q.pop(val)) { continue; }
+        if(val != i)
+            FAIL("out of order");
+    }
+    producer.join();
+    REQUIRE(q.empty());
+};
+
+struct record64 {
+    uint64_t words[8];
+};
+
+TEST_CASE("bulk push/pop", "[unit]"){
+    nsqueue::spsc_queue<record64, 16> q;
+    std::vector<record64> in(40), out(40);
+    for(uint64_t i{0}; i < in.size(); ++i)
+        for(uint64_t w{0}; w < 8; ++w)
+            in[i].words[w] = i * 8 + w;
+
+    REQUIRE(q.push_bulk(in.data(), 10) == 10);
+    REQUIRE(q.pop_bulk(out.data(), 6) == 6);
+    // Wraps around the end of the ring and stops at capacity.
+    REQUIRE(q.push_bulk(in.data() + 10, 30, nsqueue::store_hint::streaming) == 12);
+    REQUIRE(q.full());
+    REQUIRE(q.pop_bulk(out.data() + 6, 40) == 16);
+    REQUIRE(q.empty());
+    REQUIRE(q.pop_bulk(out.data(), 1) == 0);
+
+    for(uint64_t i{0}; i < 22; ++i)
+        for(uint64_t w{0}; w < 8; ++w)
+            REQUIRE(out[i].words[w] == i * 8 + w);
+};
+
+TEST_CASE("bulk copy kernels", "[unit]"){
+    using nsqueue::details::copy_isa;
+    std::vector<copy_isa> isas{copy_isa::scalar};
+    auto best = nsqueue::details::detect_copy_isa();
+    if(best == copy_isa::avx512) isas.push_back(copy_isa::avx512);
+    if(best != copy_isa::scalar) isas.push_back(copy_isa::avx2);
+
+    constexpr std::size_t bytes = 200, stride = 256, count = 5;
+    alignas(64) std::byte src[count * bytes];
+    for(std::size_t i{0}; i < sizeof(src); ++i)
+        src[i] = static_cast<std::byte>(i * 7);
+
+    for(auto isa : isas){
+        for(bool stream : {false, true}){
+            alignas(64) std::byte dst[count * stride]{};
+            nsqueue::details::copy_kernel(isa)(dst, stride, src, bytes, bytes, count, stream);
+            nsqueue::details::store_fence();
+            for(std::size_t r{0}; r < count; ++r)
+                REQUIRE(std::memcmp(dst + r * stride, src + r * bytes, bytes) == 0);
+        }
+    }
+};
+
+namespace {
+
+struct counting_resource : std::pmr::memory_resource {
+    std::size_t outstanding{0};
+
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        outstanding += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+        outstanding -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+}
+
+TEST_CASE("required_bytes accounts for sizeof(T)", "[unit]"){
+    using small_q = nsqueue::spsc_queue<int, 8, void>;
+    using big_q   = nsqueue::spsc_queue<std::array<char, 200>, 4, void>;
+    constexpr auto slot = nsqueue::profiles::native::slot_alignment;
+    STATIC_REQUIRE(small_q::required_bytes() == 8 * slot);
+    STATIC_REQUIRE(big_q::required_bytes() == 4 * ((200 + slot - 1) / slot * slot));
+    STATIC_REQUIRE(big_q::required_alignment() == slot);
+};
+
+TEST_CASE("hardware profiles", "[unit]"){
+    using spread = nsqueue::spsc_queue<int, 8, void, nsqueue::profiles::x86_64>;
+    STATIC_REQUIRE(spread::required_alignment() == 128);
+    STATIC_REQUIRE(alignof(spread) == 128);
+    STATIC_REQUIRE(sizeof(spread) >= 3 * 128);
+
+    // Co-located producer/consumer: natural slots and all state within one line.
+    using packed = nsqueue::spsc_queue<int, 8, void, nsqueue::profiles::smt_sibling<>>;
+    STATIC_REQUIRE(packed::required_bytes() == 8 * sizeof(int));
+    STATIC_REQUIRE(sizeof(packed) <= nsqueue::profiles::native::cache_line);
+
+    alignas(packed::required_alignment()) std::byte buffer[packed::required_bytes()];
+    packed q(buffer, sizeof(buffer));
+    int val{};
+    for(int lap{0}; lap < 3; ++lap){
+        for(int i{0}; i < 8; ++i)
+            REQUIRE(q.emplace(i));
+        REQUIRE(q.full());
+        for(int i{0}; i < 8; ++i){
+            REQUIRE(q.pop(val)); REQUIRE(val == i);
+        }
+    }
+};
+
+TEST_CASE("external buffer", "[unit]"){
+    using queue = nsqueue::spsc_queue<int, 8, void>;
+    alignas(queue::required_alignment()) std::byte slab[2 * queue::required_bytes()];
+
+    // Two queues carved out of one slab.
+    queue a(slab, queue::required_bytes());
+    queue b(slab + queue::required_bytes(), queue::required_bytes());
+    for(int i{0}; i < 8; ++i){
+        REQUIRE(a.emplace(i));
+        REQUIRE(b.emplace(-i));
+    }
+    REQUIRE(a.full());
+    int va{}, vb{};
+    for(int i{0}; i < 8; ++i){
+        REQUIRE(a.pop(va)); REQUIRE(va == i);
+        REQUIRE(b.pop(vb)); REQUIRE(vb == -i);
+    }
+
+    REQUIRE_THROWS_AS(queue(slab, queue::required_bytes() - 1), std::invalid_argument);
+    REQUIRE_THROWS_AS(queue(slab + 8, queue::required_bytes()), std::invalid_argument);
+};
+
+TEST_CASE("pmr allocator", "[unit]"){
+    using queue = nsqueue::spsc_queue<std::unique_ptr<int>, 16, std::pmr::polymorphic_allocator<int>>;
+    counting_resource resource;
+    {
+        queue q{std::pmr::polymorphic_allocator<int>(&resource)};
+        REQUIRE(resource.outstanding == queue::required_bytes());
+        REQUIRE(q.emplace(std::make_unique<int>(5)));
+        std::unique_ptr<int> p;
+        REQUIRE(q.pop(p));
+        REQUIRE(*p == 5);
+    }
+    REQUIRE(resource.outstanding == 0);
+};
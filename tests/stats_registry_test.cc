@@ -0,0 +1,138 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "spsc_queue.h"
+#include "stats_registry.h"
+
+namespace {
+
+std::string segment_name(const std::string& name) {
+    return "/nsqueue_" + name + "_" + std::to_string(::getpid());
+}
+
+}  // namespace
+
+TEST_CASE("monitored_queue publishes counters", "[unit]") {
+    using queue = nsqueue::spsc_queue<int, 4>;
+    auto                    name = segment_name("counters");
+    nsqueue::stats_registry registry(name, 4);
+    queue                   q;
+    nsqueue::monitored_queue<queue> mq(q, registry, "orders");
+
+    for (int i{0}; i < 4; ++i)
+        REQUIRE(mq.push(i));
+    REQUIRE_FALSE(mq.push(4));
+    int val{};
+    REQUIRE(mq.pop(val));
+    REQUIRE(mq.consume_one([](int v) { REQUIRE(v == 1); }));
+    REQUIRE(mq.consume_all([](int) {}) == 2);
+    REQUIRE_FALSE(mq.pop(val));
+
+    nsqueue::stats_view view(registry.name());
+    auto                samples = view.sample();
+    REQUIRE(samples.size() == 1);
+    REQUIRE(samples[0].name == "orders");
+    REQUIRE(samples[0].pid == ::getpid());
+    REQUIRE(samples[0].capacity == 4);
+    REQUIRE(samples[0].enqueued == 4);
+    REQUIRE(samples[0].dequeued == 4);
+    REQUIRE(samples[0].full_stalls == 1);
+    REQUIRE(samples[0].empty_stalls == 1);
+    REQUIRE(samples[0].depth() == 0);
+
+    REQUIRE(mq.push(7));
+    REQUIRE(view.sample()[0].depth() == 1);
+};
+
+TEST_CASE("stats_registry slots are reused", "[unit]") {
+    auto                    name = segment_name("slots");
+    nsqueue::stats_registry registry(name, 2);
+    nsqueue::stats_view     view(registry.name());
+
+    {
+        auto a = registry.add("a", 8);
+        auto b = registry.add("b", 8);
+        REQUIRE_THROWS_AS(registry.add("c", 8), std::length_error);
+        REQUIRE(view.sample().size() == 2);
+    }
+    REQUIRE(view.sample().empty());
+
+    auto longName = registry.add(std::string(100, 'x'), 8);
+    REQUIRE(view.sample()[0].name == std::string(nsqueue::queue_stats::name_size - 1, 'x'));
+};
+
+TEST_CASE("stats_view requires an existing segment", "[unit]") {
+    REQUIRE_THROWS_AS(nsqueue::stats_view(segment_name("missing")), std::system_error);
+    std::string name;
+    {
+        nsqueue::stats_registry registry(segment_name("unlinked"), 1);
+        name = registry.name();
+    }
+    REQUIRE_THROWS_AS(nsqueue::stats_view(name), std::system_error);
+    REQUIRE(nsqueue::stats_view::segments(segment_name("unlinked")).empty());
+};
+
+TEST_CASE("stats_registry segments are per registry", "[unit]") {
+    auto prefix = segment_name("shared");
+    // Left behind by a process that no longer exists; pids never get this large.
+    auto stale = nsqueue::details::shared_memory::create(prefix + ".999999999.0", 4096);
+
+    nsqueue::stats_registry first(prefix, 1);
+    nsqueue::stats_registry second(prefix, 1);
+    REQUIRE(first.name() != second.name());
+    REQUIRE_THROWS_AS(nsqueue::details::shared_memory::open(stale.name()), std::system_error);
+
+    auto a        = first.add("a", 8);
+    auto b        = second.add("b", 8);
+    auto segments = nsqueue::stats_view::segments(prefix);
+    REQUIRE(segments.size() == 2);
+    std::vector<std::string> names;
+    for (auto const& seg : segments)
+        for (auto const& q : nsqueue::stats_view(seg).sample())
+            names.push_back(q.name);
+    std::sort(names.begin(), names.end());
+    REQUIRE(names == std::vector<std::string>{"a", "b"});
+};
+
+TEST_CASE("stress monitored_queue", "[stress]") {
+    using queue                 = nsqueue::spsc_queue<std::uint64_t, 64>;
+    constexpr std::uint64_t N   = 1'000'000;
+    auto                    name = segment_name("stress");
+    nsqueue::stats_registry registry(name, 1);
+    queue                   q;
+    nsqueue::monitored_queue<queue> mq(q, registry, "stress");
+    nsqueue::stats_view     view(registry.name());
+
+    std::thread producer([&] {
+        for (std::uint64_t i{0}; i < N; ++i)
+            while (!mq.push(i))
+                std::this_thread::yield();
+    });
+
+    std::uint64_t lastEnqueued{0};
+    for (std::uint64_t i{0}; i < N; ++i) {
+        std::uint64_t val;
+        while (!mq.pop(val))
+            std::this_thread::yield();
+        REQUIRE(val == i);
+        if (i % 4096 == 0) {
+            auto s = view.sample().at(0);
+            REQUIRE(s.enqueued >= lastEnqueued);
+            REQUIRE(s.depth() <= 64);
+            lastEnqueued = s.enqueued;
+        }
+    }
+    producer.join();
+
+    auto s = view.sample().at(0);
+    REQUIRE(s.enqueued == N);
+    REQUIRE(s.dequeued == N);
+};
@@ -0,0 +1,101 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.h"
+
+TEST_CASE("thread_pool runs submitted tasks", "[unit]") {
+    std::atomic<int> count{0};
+    {
+        nsqueue::thread_pool pool(4);
+        REQUIRE(pool.size() == 4);
+        for (int i{0}; i < 1000; ++i)
+            pool.submit([&] { count.fetch_add(1, std::memory_order_relaxed); });
+    }
+    REQUIRE(count.load() == 1000);
+};
+
+TEST_CASE("thread_pool nested submit", "[unit]") {
+    std::atomic<int> count{0};
+    {
+        nsqueue::thread_pool pool(2);
+        for (int i{0}; i < 10; ++i) {
+            pool.submit([&] {
+                for (int j{0}; j < 100; ++j)
+                    pool.submit([&] { count.fetch_add(1, std::memory_order_relaxed); });
+            });
+        }
+    }
+    REQUIRE(count.load() == 1000);
+};
+
+TEST_CASE("thread_pool local overflow spills to injection queue", "[unit]") {
+    constexpr int    tasks = 3 * nsqueue::thread_pool::local_capacity;
+    std::atomic<int> count{0};
+    {
+        nsqueue::thread_pool pool(1);
+        pool.submit([&] {
+            for (int j{0}; j < tasks; ++j)
+                pool.submit([&] { count.fetch_add(1, std::memory_order_relaxed); });
+        });
+    }
+    REQUIRE(count.load() == tasks);
+};
+
+TEST_CASE("thread_pool runs nested tasks inline when all queues are full", "[unit]") {
+    constexpr int tasks
+        = 2 * (nsqueue::thread_pool::local_capacity + nsqueue::thread_pool::inject_capacity);
+    std::atomic<int> count{0};
+    {
+        nsqueue::thread_pool pool(1);
+        pool.submit([&] {
+            for (int j{0}; j < tasks; ++j)
+                pool.submit([&] { count.fetch_add(1, std::memory_order_relaxed); });
+        });
+    }
+    REQUIRE(count.load() == tasks);
+};
+
+TEST_CASE("thread_pool rejects cpus it cannot pin to", "[unit]") {
+    REQUIRE_THROWS_AS(nsqueue::thread_pool(2, {-1, 4095}), std::system_error);
+
+    std::atomic<int> count{0};
+    {
+        nsqueue::thread_pool pool(2, {-1});
+        pool.submit([&] { count.fetch_add(1, std::memory_order_relaxed); });
+    }
+    REQUIRE(count.load() == 1);
+};
+
+TEST_CASE("thread_pool move-only task", "[unit]") {
+    std::atomic<int> value{0};
+    {
+        nsqueue::thread_pool pool(1);
+        auto                 p = std::make_unique<int>(42);
+        pool.submit([&value, p = std::move(p)] { value.store(*p); });
+    }
+    REQUIRE(value.load() == 42);
+};
+
+TEST_CASE("thread_pool stress", "[stress]") {
+    constexpr int       submitters = 4;
+    constexpr int       per_thread = 50'000;
+    std::atomic<long>   sum{0};
+    {
+        nsqueue::thread_pool     pool(4);
+        std::vector<std::thread> threads;
+        for (int s{0}; s < submitters; ++s) {
+            threads.emplace_back([&] {
+                for (int i{1}; i <= per_thread; ++i)
+                    pool.submit([&sum, i] { sum.fetch_add(i, std::memory_order_relaxed); });
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+    }
+    REQUIRE(sum.load() == long{submitters} * per_thread * (per_thread + 1) / 2);
+};
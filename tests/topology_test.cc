@@ -0,0 +1,132 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include "topology.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+void write_file(fs::path const& path, std::string const& content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content << '\n';
+}
+
+// 16 cpus, 8 two-way SMT cores (cpu n and n + 8 are siblings). Node 0 holds cores 0-3 split over
+// two last-level caches, node 1 holds cores 4-7 behind a single one.
+struct fake_sysfs {
+    fs::path root = fs::temp_directory_path() / ("nsqueue_sysfs_" + std::to_string(::getpid()));
+
+    fake_sysfs() {
+        write_file(root / "cpu" / "online", "0-15");
+        for (int cpu{0}; cpu < 16; ++cpu) {
+            const int core = cpu % 8;
+            auto      dir  = root / "cpu" / ("cpu" + std::to_string(cpu));
+            write_file(dir / "topology" / "thread_siblings_list",
+                       std::to_string(core) + "," + std::to_string(core + 8));
+            write_file(dir / "topology" / "physical_package_id", core < 4 ? "0" : "1");
+            write_file(dir / "cache" / "index0" / "level", "1");
+            write_file(dir / "cache" / "index0" / "shared_cpu_list",
+                       std::to_string(core) + "," + std::to_string(core + 8));
+            write_file(dir / "cache" / "index1" / "level", "3");
+            write_file(dir / "cache" / "index1" / "shared_cpu_list",
+                       core < 2 ? "0-1,8-9" : core < 4 ? "2-3,10-11" : "4-7,12-15");
+        }
+        write_file(root / "node" / "node0" / "cpulist", "0-3,8-11");
+        write_file(root / "node" / "node1" / "cpulist", "4-7,12-15");
+        write_file(root / "node" / "online", "0-1");
+    }
+    ~fake_sysfs() { fs::remove_all(root); }
+};
+
+}  // namespace
+
+TEST_CASE("parse_cpu_list", "[unit]") {
+    REQUIRE(nsqueue::parse_cpu_list("0-3,8,10-11\n") == std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+    REQUIRE(nsqueue::parse_cpu_list("5") == std::vector<int>{5});
+    REQUIRE(nsqueue::parse_cpu_list("\n").empty());
+    REQUIRE_THROWS_AS(nsqueue::parse_cpu_list("3-1"), std::invalid_argument);
+    REQUIRE_THROWS_AS(nsqueue::parse_cpu_list("0-x"), std::invalid_argument);
+};
+
+TEST_CASE("topology discovery", "[unit]") {
+    fake_sysfs sys;
+    auto       topo = nsqueue::topology::discover(sys.root);
+
+    REQUIRE(topo.cpus().size() == 16);
+    REQUIRE(topo.cores().size() == 8);
+    REQUIRE(topo.llc_domains().size() == 3);
+    REQUIRE(topo.numa_nodes().size() == 2);
+
+    auto const* cpu9 = topo.find(9);
+    REQUIRE(cpu9 != nullptr);
+    REQUIRE(cpu9->core == 1);
+    REQUIRE(cpu9->siblings == std::vector<int>{1, 9});
+    REQUIRE(cpu9->llc == 0);
+    REQUIRE(cpu9->node == 0);
+    REQUIRE(topo.find(12)->node == 1);
+    REQUIRE(topo.find(12)->package == 1);
+    REQUIRE(topo.find(42) == nullptr);
+
+    REQUIRE_THROWS_AS(nsqueue::topology::discover(sys.root / "missing"), std::runtime_error);
+};
+
+TEST_CASE("topology pair recommendations", "[unit]") {
+    using nsqueue::placement;
+    fake_sysfs sys;
+    auto       topo = nsqueue::topology::discover(sys.root);
+
+    auto check = [&](placement where, int producer, int consumer) {
+        auto pair = topo.recommend_pair(where);
+        REQUIRE(pair.has_value());
+        REQUIRE(pair->producer == producer);
+        REQUIRE(pair->consumer == consumer);
+    };
+    check(placement::smt_sibling, 0, 8);
+    check(placement::shared_cache, 0, 1);
+    check(placement::same_node, 0, 2);
+    check(placement::cross_node, 0, 4);
+
+    // Pairs take whole cores, so no two pairs share one.
+    auto pairs = topo.recommend_pairs(8, placement::shared_cache);
+    REQUIRE(pairs.size() == 4);
+    std::set<int> cores;
+    for (auto const& p : pairs) {
+        REQUIRE(cores.insert(topo.find(p.producer)->core).second);
+        REQUIRE(cores.insert(topo.find(p.consumer)->core).second);
+    }
+
+    auto restricted = topo.recommend_pair(placement::shared_cache, {8, 9, 10});
+    REQUIRE(restricted.has_value());
+    REQUIRE(restricted->producer == 8);
+    REQUIRE(restricted->consumer == 9);
+    REQUIRE_FALSE(topo.recommend_pair(placement::cross_node, {0, 1, 2, 3}).has_value());
+};
+
+TEST_CASE("topology of this machine", "[unit]") {
+    if (!fs::exists("/sys/devices/system/cpu/online"))
+        return;
+    auto topo = nsqueue::topology::discover();
+    REQUIRE_FALSE(topo.cpus().empty());
+
+    auto                      allowed = nsqueue::allowed_cpus();
+    nsqueue::thread_placement here;
+    here.cpu = allowed.empty() ? -1 : allowed.front();
+
+    std::atomic<bool> release{false};
+    std::thread       t([&] {
+        while (!release.load())
+            std::this_thread::yield();
+    });
+    REQUIRE(nsqueue::apply_placement(t, here));
+    release.store(true);
+    t.join();
+};
@@ -0,0 +1,76 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#include "spsc_queue.h"
+#include "traffic_trace.h"
+
+namespace {
+
+std::filesystem::path temp_file(const std::string& name) {
+    return std::filesystem::temp_directory_path()
+         / ("nsqueue_" + name + "_" + std::to_string(::getpid()) + ".trace");
+}
+
+}  // namespace
+
+TEST_CASE("recording_queue records both sides", "[unit]") {
+    nsqueue::spsc_queue<int, 8>                          q;
+    nsqueue::recording_queue<nsqueue::spsc_queue<int, 8>> rec(q);
+
+    for (int i{0}; i < 5; ++i)
+        REQUIRE(rec.push(i));
+    int val{};
+    REQUIRE(rec.pop(val));
+    REQUIRE(val == 0);
+    REQUIRE(rec.consume_one([](int v) { REQUIRE(v == 1); }));
+
+    auto trace = rec.trace();
+    REQUIRE(trace.enqueues.size() == 5);
+    REQUIRE(trace.dequeues.size() == 2);
+    REQUIRE(trace.enqueues[0].bytes == sizeof(int));
+    for (std::size_t i{1}; i < trace.enqueues.size(); ++i)
+        REQUIRE(trace.enqueues[i].time_ns >= trace.enqueues[i - 1].time_ns);
+};
+
+TEST_CASE("recording_queue custom payload size", "[unit]") {
+    nsqueue::spsc_queue<std::string, 4> q;
+    auto size = [](std::string const& s) { return static_cast<uint32_t>(s.size()); };
+    nsqueue::recording_queue<nsqueue::spsc_queue<std::string, 4>, decltype(size)> rec(q, size);
+
+    REQUIRE(rec.push(std::string("hello")));
+    REQUIRE(rec.trace().enqueues.at(0).bytes == 5);
+};
+
+TEST_CASE("traffic_trace save/load round trip", "[unit]") {
+    nsqueue::traffic_trace trace;
+    trace.enqueues = {{0, 8}, {7, 64}, {1'000'000'000'000ull, 4096}};
+    trace.dequeues = {{3, 8}};
+
+    auto path = temp_file("roundtrip");
+    trace.save(path);
+    auto loaded = nsqueue::traffic_trace::load(path);
+    std::filesystem::remove(path);
+
+    REQUIRE(loaded.enqueues.size() == 3);
+    REQUIRE(loaded.dequeues.size() == 1);
+    for (std::size_t i{0}; i < 3; ++i) {
+        REQUIRE(loaded.enqueues[i].time_ns == trace.enqueues[i].time_ns);
+        REQUIRE(loaded.enqueues[i].bytes == trace.enqueues[i].bytes);
+    }
+    REQUIRE(loaded.dequeues[0].time_ns == 3);
+};
+
+TEST_CASE("traffic_trace rejects foreign files", "[unit]") {
+    auto path = temp_file("garbage");
+    {
+        std::ofstream f(path, std::ios::binary);
+        f << "definitely not a trace";
+    }
+    REQUIRE_THROWS_AS(nsqueue::traffic_trace::load(path), std::runtime_error);
+    std::filesystem::remove(path);
+};
@@ -0,0 +1,137 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "stats_registry.h"
+
+// Live view of the queues every process publishes to a stats_registry under one prefix.
+//   nsqueue-top [-s prefix] [-i interval_ms] [-n iterations]
+// Each registry has a segment of its own (<prefix>.<pid>.<n>); they are rediscovered on every
+// refresh, so processes may come and go. Depth is the latest sample; rates are per second over
+// the last interval. With -n the screen is not cleared between refreshes, so the output can be
+// piped.
+
+namespace {
+
+void usage() {
+    std::fprintf(stderr, "usage: nsqueue-top [-s prefix] [-i interval_ms] [-n iterations]\n");
+}
+
+double per_second(std::uint64_t now, std::uint64_t before, double seconds) {
+    return now >= before ? static_cast<double>(now - before) / seconds : 0.0;
+}
+
+// Keeps a view open for every live segment under the prefix and samples them all. Segments
+// that vanish or are still being set up are skipped until the next call.
+class segment_set {
+public:
+    explicit segment_set(std::string prefix) : prefix_(std::move(prefix)) {}
+
+    std::vector<nsqueue::queue_sample> sample() {
+        std::map<std::string, nsqueue::stats_view> next;
+        for (auto& name : nsqueue::stats_view::segments(prefix_)) {
+            if (auto it = views_.find(name); it != views_.end()) {
+                next.emplace(name, std::move(it->second));
+                continue;
+            }
+            try {
+                next.emplace(name, nsqueue::stats_view(name));
+            } catch (std::exception const&) {
+            }
+        }
+        views_ = std::move(next);
+
+        std::vector<nsqueue::queue_sample> out;
+        for (auto const& [name, view] : views_)
+            for (auto& q : view.sample())
+                out.push_back(std::move(q));
+        return out;
+    }
+
+    [[nodiscard]] std::size_t processes() const noexcept { return views_.size(); }
+
+private:
+    std::string                                prefix_;
+    std::map<std::string, nsqueue::stats_view> views_;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string prefix     = nsqueue::stats_registry::default_name;
+    long        intervalMs = 1000;
+    long        iterations = 0;
+    for (int i{1}; i < argc; ++i) {
+        if (i + 1 < argc && std::strcmp(argv[i], "-s") == 0) {
+            prefix = argv[++i];
+        } else if (i + 1 < argc && std::strcmp(argv[i], "-i") == 0) {
+            intervalMs = std::strtol(argv[++i], nullptr, 10);
+        } else if (i + 1 < argc && std::strcmp(argv[i], "-n") == 0) {
+            iterations = std::strtol(argv[++i], nullptr, 10);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (intervalMs <= 0) {
+        usage();
+        return 1;
+    }
+
+    try {
+        segment_set view(prefix);
+
+        using clock = std::chrono::steady_clock;
+        using key   = std::pair<std::int64_t, std::string>;
+        std::map<key, nsqueue::queue_sample> previous;
+        auto                                 last = clock::now();
+        for (auto const& q : view.sample())
+            previous[{q.pid, q.name}] = q;
+
+        for (long n{0}; iterations == 0 || n < iterations; ++n) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+            auto samples = view.sample();
+            auto now     = clock::now();
+            auto seconds = std::chrono::duration<double>(now - last).count();
+            last         = now;
+
+            if (iterations == 0)
+                std::printf("\x1b[H\x1b[2J");
+            std::printf("%s  %zu segments  %zu queues  every %ld ms\n", prefix.c_str(),
+                        view.processes(), samples.size(), intervalMs);
+            std::printf("%8s  %-24s %10s %10s %14s %14s %12s %12s\n", "pid", "queue", "depth",
+                        "capacity", "enqueue/s", "dequeue/s", "full/s", "empty/s");
+
+            std::map<key, nsqueue::queue_sample> current;
+            for (auto& q : samples) {
+                key  k{q.pid, q.name};
+                auto it   = previous.find(k);
+                auto base = it != previous.end() ? it->second : nsqueue::queue_sample{};
+                if (it == previous.end() || q.enqueued < base.enqueued)
+                    base = q;  // new or re-registered queue
+                std::printf("%8lld  %-24s %10llu %10llu %14.0f %14.0f %12.0f %12.0f\n",
+                            static_cast<long long>(q.pid), q.name.c_str(),
+                            static_cast<unsigned long long>(q.depth()),
+                            static_cast<unsigned long long>(q.capacity),
+                            per_second(q.enqueued, base.enqueued, seconds),
+                            per_second(q.dequeued, base.dequeued, seconds),
+                            per_second(q.full_stalls, base.full_stalls, seconds),
+                            per_second(q.empty_stalls, base.empty_stalls, seconds));
+                current[k] = std::move(q);
+            }
+            std::fflush(stdout);
+            previous = std::move(current);
+        }
+    } catch (std::exception const& e) {
+        std::fprintf(stderr, "nsqueue-top: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}